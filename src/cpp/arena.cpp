@@ -0,0 +1,67 @@
+#include "arena.h"
+#include <cstring>
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    // Large blocks get a chunk of their own, slotted in before the current
+    // chunk so its free tail stays in use
+    if (bytes > chunk_bytes_ / 4) {
+        Chunk chunk{std::unique_ptr<char[]>(new char[bytes + alignment]), bytes + alignment};
+        const uintptr_t address = reinterpret_cast<uintptr_t>(chunk.data.get());
+        void* block = reinterpret_cast<void*>((address + alignment - 1) & ~uintptr_t(alignment - 1));
+        bytes_reserved_ += chunk.size;
+        bytes_used_ += chunk.size;
+        chunks_.insert(chunks_.empty() ? chunks_.end() : chunks_.end() - 1, std::move(chunk));
+        return block;
+    }
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(cursor_);
+    uintptr_t aligned = (address + alignment - 1) & ~uintptr_t(alignment - 1);
+    if (cursor_ == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+        grow(bytes + alignment);
+        address = reinterpret_cast<uintptr_t>(cursor_);
+        aligned = (address + alignment - 1) & ~uintptr_t(alignment - 1);
+    }
+    cursor_ = reinterpret_cast<char*>(aligned + bytes);
+    bytes_used_ += aligned + bytes - address;
+    return reinterpret_cast<void*>(aligned);
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    if (text.empty()) return std::string_view();
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+void Arena::grow(size_t bytes) {
+    const size_t size = bytes > chunk_bytes_ ? bytes : chunk_bytes_;
+    chunks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    cursor_ = chunks_.back().data.get();
+    end_ = cursor_ + size;
+    bytes_reserved_ += size;
+}
+
+void Arena::reset() {
+    bytes_used_ = 0;
+    if (chunks_.empty()) return;
+    // Keep the first regular-sized chunk; oversized ones are not worth keeping
+    size_t keep = chunks_.size();
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        if (chunks_[i].size == chunk_bytes_) {
+            keep = i;
+            break;
+        }
+    }
+    if (keep == chunks_.size()) {
+        chunks_.clear();
+        cursor_ = end_ = nullptr;
+        bytes_reserved_ = 0;
+        return;
+    }
+    Chunk first = std::move(chunks_[keep]);
+    chunks_.clear();
+    chunks_.push_back(std::move(first));
+    cursor_ = chunks_.back().data.get();
+    end_ = cursor_ + chunks_.back().size;
+    bytes_reserved_ = chunks_.back().size;
+}
@@ -0,0 +1,56 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Bump allocator for data that lives and dies with one segment, such as SKU
+// ids. Allocations are carved from large chunks and never freed one by one;
+// everything goes at once when the arena is destroyed (the segment is
+// replaced) or reset(). Hundreds of thousands of small strings then cost a
+// few dozen chunk-sized heap blocks, which the WASM heap can reuse whole on
+// the next load instead of fragmenting linear memory.
+//
+// Chunks never move, so pointers and string_views into the arena stay valid
+// for its lifetime. Not thread-safe: writers own the segment exclusively.
+class Arena {
+public:
+    static constexpr size_t kDefaultChunkBytes = 256 * 1024;
+
+    explicit Arena(size_t chunk_bytes = kDefaultChunkBytes) : chunk_bytes_(chunk_bytes) {}
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Uninitialized memory; alignment must be a power of two
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    // Copies text into the arena and returns a view of the copy
+    std::string_view copy(std::string_view text);
+
+    // Frees every chunk but the first, which is kept for reuse
+    void reset();
+
+    size_t bytes_used() const { return bytes_used_; }         // Handed out, including alignment padding
+    size_t bytes_reserved() const { return bytes_reserved_; } // Held in chunks
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    // Starts a chunk that fits at least `bytes`
+    void grow(size_t bytes);
+
+    std::vector<Chunk> chunks_;
+    char* cursor_ = nullptr; // Next free byte of the last chunk
+    char* end_ = nullptr;
+    size_t chunk_bytes_;
+    size_t bytes_used_ = 0;
+    size_t bytes_reserved_ = 0;
+};
+
+#endif // ARENA_H
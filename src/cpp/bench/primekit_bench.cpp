@@ -0,0 +1,239 @@
+// primekit_bench: load and filter benchmark across catalog sizes.
+//
+// Usage: primekit_bench [--sizes 10000,100000,1000000,10000000] [--queries N] [--seed S]
+//                        [--zipf S] [--attributes N --values M] [--cluster] [--cache]
+//                        [--log-level L]
+//
+// Builds natively and, under Emscripten, as a Node script
+// (node build/wasm_build/primekit_bench.js ...), so the same workload measures
+// both the native engine and the WASM module without JS sort/DOM time mixed in.
+//
+// For each size a single-brand inventory is generated in memory with
+// CatalogGenerator (apparel schema by default, optionally Zipf-skewed), then:
+//   - initializePrimesFromJson and initializeFromJson are timed (ms, MB/s, ns/SKU);
+//     --cluster loads with PrimeKit::set_cluster_on_load(true)
+//   - the result cache is off unless --cache is given, so repeated query SFIs
+//     in the mix are executed rather than answered from the cache
+//   - a mix of queries of different selectivity is run through perform_filter
+//     and reported as p50/p99 latency, ns/SKU and mean matches per class, then
+//     rerun as one perform_filter_batch / perform_filter_batch_counts call
+//   - peak RSS is reported after the load, after the perform_filter mix and
+//     after the batch, which holds every result set of the mix at once (the
+//     process high-water mark, so each covers the sizes so far)
+// Engine logging is cut to warnings (--log-level 0..4 to change), so the
+// repeated loads inside the timed regions don't print.
+// Loading streams the JSON through the SAX InventoryReader, so no DOM is
+// built; peak memory is roughly the generated JSON text (~115 MB per million
+// SKUs) plus the loaded segment, about 250 MB per million SKUs in all
+// (~2.5 GB at 10M).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "primekit.h"
+#include "log.h"
+#include "gen/catalog_generator.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Query classes from broad to selective; weights approximate facet UI traffic
+struct QueryClass {
+    const char* name;
+    int weight;
+    size_t attribute_count; // One value picked from each of this many distinct attributes
+};
+
+const std::vector<QueryClass>& query_classes() {
+    static const std::vector<QueryClass> classes = {
+        {"all", 5, 0},
+        {"1 attribute", 35, 1},
+        {"2 attributes", 35, 2},
+        {"3 attributes", 25, 3},
+    };
+    return classes;
+}
+
+double peak_rss_mb() {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_heap_size() / (1024.0 * 1024.0); // Linear memory only grows
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // Linux reports KiB
+#endif
+}
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Reorders samples (nth_element) instead of copying them
+double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) return 0;
+    size_t rank = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+std::vector<size_t> parse_sizes(const char* arg) {
+    std::vector<size_t> sizes;
+    const char* p = arg;
+    while (*p) {
+        char* end = nullptr;
+        unsigned long long v = std::strtoull(p, &end, 10);
+        if (end == p) break;
+        if (v) sizes.push_back(static_cast<size_t>(v));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {10000, 100000, 1000000, 10000000};
+    size_t query_count = 200;
+    CatalogConfig config = CatalogConfig::apparel();
+    config.brand_count = 1;
+    long attribute_count = -1;
+    uint32_t values = 12;
+    bool cluster = false;
+    bool cache = false; // Repeats in the mix would otherwise be cache hits
+    int log_level = PK_LOG_LEVEL_WARN; // INFO would print every load inside the timed loops
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parse_sizes(argv[++i]);
+        } else if (arg == "--queries" && i + 1 < argc) {
+            query_count = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--zipf" && i + 1 < argc) {
+            config.zipf_s = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--attributes" && i + 1 < argc) {
+            attribute_count = std::strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--values" && i + 1 < argc) {
+            values = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--cluster") {
+            cluster = true;
+        } else if (arg == "--cache") {
+            cache = true;
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            log_level = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--sizes a,b,c] [--queries N] [--seed S] [--zipf S] [--attributes N --values M] [--cluster] [--cache] [--log-level L]\n", argv[0]);
+            return 2;
+        }
+    }
+    pk_set_log_level(log_level);
+    if (attribute_count > 0) {
+        config.attributes = CatalogConfig::make_attributes(static_cast<uint32_t>(attribute_count), values, 0.3);
+    }
+
+    const auto& classes = query_classes();
+    int total_weight = 0;
+    for (const auto& c : classes) total_weight += c.weight;
+
+    for (size_t sku_count : sizes) {
+        config.sku_count = sku_count;
+        CatalogGenerator generator(config);
+        const std::string primes = generator.primes_json(0);
+        const std::string inventory = std::move(generator.generate_inventory_json()[0]);
+        std::mt19937_64 rng(config.seed);
+
+        PrimeKit kit;
+        kit.set_cluster_on_load(cluster);
+        if (!cache) kit.set_result_cache_bytes(0);
+
+        // Primes load is tiny; repeat it so the timer resolves it
+        const int prime_reps = 200;
+        auto start = Clock::now();
+        for (int r = 0; r < prime_reps; ++r) kit.initializePrimesFromJson(primes);
+        const double primes_us = ms_since(start) * 1000.0 / prime_reps;
+
+        start = Clock::now();
+        kit.initializeFromJson(inventory);
+        const double load_ms = ms_since(start);
+        const size_t loaded = kit.sku_count();
+        const double load_rss_mb = peak_rss_mb();
+
+        // --- Queries ---
+        std::vector<std::vector<double>> latencies(classes.size());
+        std::vector<double> match_totals(classes.size(), 0);
+        std::vector<double> all_latencies;
+        all_latencies.reserve(query_count);
+        std::vector<uint64_t> query_sfis;
+        query_sfis.reserve(query_count);
+        for (size_t q = 0; q < query_count; ++q) {
+            int pick = static_cast<int>(rng() % total_weight);
+            size_t ci = 0;
+            while (pick >= classes[ci].weight) pick -= classes[ci++].weight;
+
+            // Distinct attributes, one uniformly chosen value each
+            std::vector<uint32_t> attrs(config.attributes.size());
+            for (uint32_t a = 0; a < attrs.size(); ++a) attrs[a] = a;
+            std::shuffle(attrs.begin(), attrs.end(), rng);
+            uint64_t query_sfi = 1;
+            for (size_t k = 0; k < classes[ci].attribute_count && k < attrs.size(); ++k) {
+                const uint32_t value = static_cast<uint32_t>(rng() % config.attributes[attrs[k]].value_count);
+                query_sfi *= generator.prime(0, attrs[k], value);
+            }
+
+            query_sfis.push_back(query_sfi);
+            start = Clock::now();
+            size_t matches = kit.perform_filter(query_sfi).size();
+            const double ms = ms_since(start);
+            latencies[ci].push_back(ms);
+            all_latencies.push_back(ms);
+            match_totals[ci] += matches;
+        }
+
+        const double query_rss_mb = peak_rss_mb();
+
+        // --- The same queries as one batch (single pass over the segment) ---
+        start = Clock::now();
+        kit.perform_filter_batch(query_sfis);
+        const double batch_ms = ms_since(start);
+        const double batch_rss_mb = peak_rss_mb();
+        start = Clock::now();
+        kit.perform_filter_batch_counts(query_sfis);
+        const double batch_counts_ms = ms_since(start);
+        double single_ms = 0;
+        for (double ms : all_latencies) single_ms += ms;
+
+        std::printf("\n== %zu SKUs (%.1f MB JSON) ==\n", loaded, inventory.size() / 1e6);
+        std::printf("initializePrimesFromJson: %.1f us\n", primes_us);
+        std::printf("result cache:             %s\n", cache ? "on (--cache)" : "off");
+        std::printf("initializeFromJson:       %.1f ms, %.1f MB/s, %.1f ns/SKU\n",
+                    load_ms, (inventory.size() / 1e6) / (load_ms / 1e3), load_ms * 1e6 / std::max<size_t>(loaded, 1));
+        std::printf("%-22s %8s %10s %10s %10s %12s\n", "perform_filter", "queries", "p50 ms", "p99 ms", "ns/SKU", "avg matches");
+        for (size_t ci = 0; ci < classes.size(); ++ci) {
+            auto& lat = latencies[ci];
+            if (lat.empty()) continue;
+            const double p50 = percentile(lat, 0.50);
+            std::printf("%-22s %8zu %10.3f %10.3f %10.2f %12.0f\n", classes[ci].name, lat.size(), p50,
+                        percentile(lat, 0.99), p50 * 1e6 / std::max<size_t>(loaded, 1), match_totals[ci] / lat.size());
+        }
+        const double p50 = percentile(all_latencies, 0.50);
+        std::printf("%-22s %8zu %10.3f %10.3f %10.2f\n", "(mix)", all_latencies.size(), p50,
+                    percentile(all_latencies, 0.99), p50 * 1e6 / std::max<size_t>(loaded, 1));
+        std::printf("batch of %zu: %.2f ms one by one, %.2f ms perform_filter_batch, %.2f ms counts only\n",
+                    query_sfis.size(), single_ms, batch_ms, batch_counts_ms);
+        std::printf("peak RSS: %.1f MB after load, %.1f MB after perform_filter, %.1f MB after perform_filter_batch\n",
+                    load_rss_mb, query_rss_mb, batch_rss_mb);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+// Embind bindings for the WASM build. Kept out of primekit.cpp so the core
+// library stays platform-neutral and links into native targets.
+#include "primekit.h"
+#include "query_cursor.h"
+#include "log.h"
+#include <emscripten/bind.h>
+#include <emscripten/val.h>
+
+// --- Embind Bindings ---
+
+using namespace emscripten;
+
+// Takes the selected primes as a Uint32Array (or plain array), so JS never
+// builds a BigInt product or rounds it through a Number
+static std::vector<FilterResult> perform_filter_primes_js(PrimeKit& kit, const val& primes) {
+    const std::vector<uint32_t> values = convertJSArrayToNumberVector<uint32_t>(primes);
+    return kit.perform_filter_primes(values);
+}
+
+// Same, into a ResultBuffer. Primes are read into a stack array: more than
+// 64 distinct primes > 1 can't have a 64-bit product, so longer selections
+// (repeats aside) match nothing anyway and only those take the vector path.
+static void perform_filter_primes_into_js(PrimeKit& kit, const val& primes, ResultBuffer& out) {
+    const size_t count = primes["length"].as<size_t>();
+    uint32_t values[64];
+    if (count > 64) {
+        const std::vector<uint32_t> all = convertJSArrayToNumberVector<uint32_t>(primes);
+        kit.perform_filter_primes_into(all.data(), all.size(), out);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) values[i] = primes[i].as<uint32_t>();
+    kit.perform_filter_primes_into(values, count, out);
+}
+
+static QueryPage query_page_primes_js(PrimeKit& kit, const val& primes, const std::string& cursor, uint32_t limit,
+                                      ResultBuffer& out) {
+    const std::vector<uint32_t> values = convertJSArrayToNumberVector<uint32_t>(primes);
+    return kit.query_page_primes(values.data(), values.size(), cursor, limit, out);
+}
+
+static std::vector<SoftMatch> soft_filter_primes_js(PrimeKit& kit, const val& primes, uint32_t min_matched,
+                                                    uint32_t limit) {
+    const std::vector<uint32_t> values = convertJSArrayToNumberVector<uint32_t>(primes);
+    return kit.soft_filter_primes(values.data(), values.size(), min_matched, limit);
+}
+
+static std::unique_ptr<QueryCursor> start_query_primes_js(PrimeKit& kit, const val& primes) {
+    const std::vector<uint32_t> values = convertJSArrayToNumberVector<uint32_t>(primes);
+    return kit.start_query_primes(values.data(), values.size());
+}
+
+static std::string cursor_strategy_js(const QueryCursor& cursor) {
+    return cursor.strategy();
+}
+
+// Typed-array views over a ResultBuffer's columns, aliasing WASM memory (no copy)
+static val result_ordinals_js(const ResultBuffer& buffer) {
+    return val(typed_memory_view(buffer.size(), buffer.ordinals()));
+}
+static val result_sfis_js(const ResultBuffer& buffer) {
+    return val(typed_memory_view(buffer.size(), buffer.sfis()));
+}
+static val result_id_offsets_js(const ResultBuffer& buffer) {
+    return val(typed_memory_view(buffer.size() + 1, buffer.id_offsets()));
+}
+static val result_id_bytes_js(const ResultBuffer& buffer) {
+    return val(typed_memory_view(buffer.id_bytes_size(), reinterpret_cast<const uint8_t*>(buffer.id_bytes())));
+}
+
+EMSCRIPTEN_BINDINGS(primekit_module) {
+
+    // Runtime log threshold (0 off .. 4 debug); levels compiled out stay silent
+    function("setLogLevel", &pk_set_log_level);
+    function("getLogLevel", &pk_log_level);
+    
+    // Ensure FilterResult struct is registered
+    value_object<FilterResult>("FilterResult")
+        .field("id", &FilterResult::id)
+        .field("sfi", &FilterResult::sfi)
+        .field("ordinal", &FilterResult::ordinal)
+        ;
+
+    // "More like this" result of PrimeKit::similar
+    value_object<SimilarItem>("SimilarItem")
+        .field("id", &SimilarItem::id)
+        .field("sfi", &SimilarItem::sfi)
+        .field("ordinal", &SimilarItem::ordinal)
+        .field("shared", &SimilarItem::shared)
+        ;
+
+    // Soft-match result of PrimeKit::soft_filter
+    value_object<SoftMatch>("SoftMatch")
+        .field("id", &SoftMatch::id)
+        .field("sfi", &SoftMatch::sfi)
+        .field("ordinal", &SoftMatch::ordinal)
+        .field("matched", &SoftMatch::matched)
+        .field("score", &SoftMatch::score)
+        ;
+
+    value_object<DecodedAttribute>("DecodedAttribute")
+        .field("ordinal", &DecodedAttribute::ordinal)
+        .field("attribute", &DecodedAttribute::attribute)
+        .field("value", &DecodedAttribute::value)
+        ;
+
+    value_object<EngineStats>("EngineStats")
+        .field("last_parse_ms", &EngineStats::last_parse_ms)
+        .field("last_encode_ms", &EngineStats::last_encode_ms)
+        .field("last_skus_loaded", &EngineStats::last_skus_loaded)
+        .field("last_distinct_sfis", &EngineStats::last_distinct_sfis)
+        .field("last_sfi_width_bits", &EngineStats::last_sfi_width_bits)
+        .field("last_overflowed_skus", &EngineStats::last_overflowed_skus)
+        .field("last_invalid_items", &EngineStats::last_invalid_items)
+        .field("last_missing_prime_values", &EngineStats::last_missing_prime_values)
+        .field("last_scan_ms", &EngineStats::last_scan_ms)
+        .field("last_materialize_ms", &EngineStats::last_materialize_ms)
+        .field("last_skus_scanned", &EngineStats::last_skus_scanned)
+        .field("last_blocks_skipped", &EngineStats::last_blocks_skipped)
+        .field("last_matches", &EngineStats::last_matches)
+        .field("last_allocations", &EngineStats::last_allocations)
+        .field("loads", &EngineStats::loads)
+        .field("queries", &EngineStats::queries)
+        .field("total_skus_scanned", &EngineStats::total_skus_scanned)
+        .field("total_matches", &EngineStats::total_matches)
+        .field("total_blocks_skipped", &EngineStats::total_blocks_skipped)
+        .field("cache_hits", &EngineStats::cache_hits)
+        .field("total_allocations", &EngineStats::total_allocations)
+        .field("total_parse_ms", &EngineStats::total_parse_ms)
+        .field("total_encode_ms", &EngineStats::total_encode_ms)
+        .field("total_scan_ms", &EngineStats::total_scan_ms)
+        .field("total_materialize_ms", &EngineStats::total_materialize_ms)
+        ;
+
+    // Result of PrimeKit::explain
+    value_object<QueryPlan>("QueryPlan")
+        .field("strategy", &QueryPlan::strategy)
+        .field("column", &QueryPlan::column)
+        .field("estimated_rows", &QueryPlan::estimated_rows)
+        .field("estimated_cost", &QueryPlan::estimated_cost)
+        .field("scan_cost", &QueryPlan::scan_cost)
+        .field("dictionary_cost", &QueryPlan::dictionary_cost)
+        .field("postings_cost", &QueryPlan::postings_cost)
+        .field("actual_rows", &QueryPlan::actual_rows)
+        .field("elapsed_ms", &QueryPlan::elapsed_ms)
+        ;
+
+    // Result of PrimeKit::query_page (rows are in the ResultBuffer passed in)
+    value_object<QueryPage>("QueryPage")
+        .field("next_cursor", &QueryPage::next_cursor)
+        .field("total", &QueryPage::total)
+        .field("rows", &QueryPage::rows)
+        ;
+
+    // Ensure vector<FilterResult> is registered
+    register_vector<FilterResult>("VectorFilterResult");
+    register_vector<std::vector<FilterResult>>("VectorVectorFilterResult");
+    register_vector<uint64_t>("VectorUInt64");
+    
+    // Keep VectorString registered (optional, no harm)
+    register_vector<std::string>("VectorString");
+
+    register_vector<uint32_t>("VectorUInt32");
+    register_vector<DecodedAttribute>("VectorDecodedAttribute");
+    register_vector<SimilarItem>("VectorSimilarItem");
+    register_vector<SoftMatch>("VectorSoftMatch");
+
+    // Reusable query destination; create once, pass to perform_filter_primes_into,
+    // read through the views, delete() when done
+    class_<ResultBuffer>("ResultBuffer")
+        .constructor<>()
+        .function("size", &ResultBuffer::size)
+        .function("ordinals", &result_ordinals_js)
+        .function("sfis", &result_sfis_js)
+        .function("id_offsets", &result_id_offsets_js)
+        .function("id_bytes", &result_id_bytes_js)
+        .function("set_watermark_rows", &ResultBuffer::set_watermark_rows)
+        .function("capacity_bytes", &ResultBuffer::capacity_bytes)
+        ;
+
+    // Resumable query from start_query / start_query_primes: call step(budget_us)
+    // until it returns true, cancel() when superseded, delete() when done
+    class_<QueryCursor>("QueryCursor")
+        .function("step", &QueryCursor::step)
+        .function("cancel", &QueryCursor::cancel)
+        .function("done", &QueryCursor::done)
+        .function("cancelled", &QueryCursor::cancelled)
+        .function("progress", &QueryCursor::progress)
+        .function("match_count", &QueryCursor::match_count)
+        .function("restarts", &QueryCursor::restarts)
+        .function("strategy", &cursor_strategy_js)
+        .function("read_into", &QueryCursor::read_into)
+        .function("page_cursor", &QueryCursor::page_cursor)
+        ;
+
+    // Bind the PrimeKit class
+    class_<PrimeKit>("PrimeKit")
+        .constructor<>()
+        .function("initializePrimesFromJson", &PrimeKit::initializePrimesFromJson)
+        .function("initializeFromJson", &PrimeKit::initializeFromJson)
+        .function("perform_filter", &PrimeKit::perform_filter)
+        .function("perform_filter_primes", &perform_filter_primes_js)
+        .function("perform_filter_into", &PrimeKit::perform_filter_into)
+        .function("perform_filter_primes_into", &perform_filter_primes_into_js)
+        .function("perform_filter_batch", &PrimeKit::perform_filter_batch)
+        .function("perform_filter_batch_counts", &PrimeKit::perform_filter_batch_counts)
+        .function("query_page", &PrimeKit::query_page)
+        .function("query_page_primes", &query_page_primes_js)
+        .function("similar", &PrimeKit::similar)
+        .function("soft_filter", &PrimeKit::soft_filter)
+        .function("soft_filter_primes", &soft_filter_primes_js)
+        .function("set_attribute_weight", &PrimeKit::set_attribute_weight)
+        .function("start_query", &PrimeKit::start_query)
+        .function("start_query_primes", &start_query_primes_js)
+        .function("explain", &PrimeKit::explain)
+        .function("set_result_cache_bytes", &PrimeKit::set_result_cache_bytes)
+        .function("decode_batch", &PrimeKit::decode_batch)
+        .function("upsert_sku", &PrimeKit::upsert_sku_json)
+        .function("remove_sku", &PrimeKit::remove_sku)
+        .function("compact", &PrimeKit::compact)
+        .function("applyDelta", &PrimeKit::applyDelta)
+        .function("set_cluster_on_load", &PrimeKit::set_cluster_on_load)
+        .function("tombstone_count", &PrimeKit::tombstone_count)
+        .function("sku_count", &PrimeKit::sku_count)
+        .function("prime_for", &PrimeKit::prime_for)
+        .function("get_stats", &PrimeKit::get_stats)
+        .function("reset_stats", &PrimeKit::reset_stats)
+        // Allow the instance to be deleted from JS, explicitly allowing raw pointer
+        .function("delete", &PrimeKit::delete_, allow_raw_pointers());
+
+} 
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef COMPILED_QUERY_H
+#define COMPILED_QUERY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "prime_table.h"
+
+// Which of a segment's SFI columns a scan reads
+enum class SfiScope : uint8_t {
+    Full,   // Product of every attribute's primes (always present)
+    Master, // Primes of the schema's master attributes only
+    Local,  // Primes of the schema's local attributes only
+};
+
+inline const char* sfi_scope_name(SfiScope scope) {
+    switch (scope) {
+        case SfiScope::Full: return "full";
+        case SfiScope::Master: return "master";
+        case SfiScope::Local: return "local";
+    }
+    return "unknown";
+}
+
+// A query SFI prepared against one segment's schema: the divisor for the
+// scan kernels, the value ids it requires for the planner and block
+// skipping.
+struct CompiledQuery {
+    uint64_t sfi = 1;
+    FastDivisor divisor;
+    // Value ids (PrimeFactorTable entry indexes) of the query's known factors
+    std::vector<uint32_t> value_ids;
+    // What is left after factoring out known primes; 1 when fully factored
+    uint64_t remainder = 1;
+    // value_ids as a ZoneMap-sized bitmask. Empty when blocks can't be
+    // skipped for this query: it has a factor outside the schema, or the
+    // schema's primes are not coprime.
+    std::vector<uint64_t> value_mask;
+    // Narrowest column that answers the query: Master or Local when every
+    // required value belongs to that side of a split schema, else Full
+    SfiScope scope = SfiScope::Full;
+};
+
+// How a single query is executed
+enum class AccessPath {
+    All,        // Query SFI 1: every live row
+    Empty,      // Provably no matches (a factor no row can carry)
+    Scan,       // Row scan over the SFI column, zone maps skipping blocks
+    Dictionary, // Test each distinct SFI once, expand matching groups
+    Postings,   // Walk the rarest value's posting list, re-check each row
+    Cache,      // Ordinals from the result cache
+};
+
+inline const char* access_path_name(AccessPath path) {
+    switch (path) {
+        case AccessPath::All: return "all";
+        case AccessPath::Empty: return "empty";
+        case AccessPath::Scan: return "scan";
+        case AccessPath::Dictionary: return "dictionary";
+        case AccessPath::Postings: return "postings";
+        case AccessPath::Cache: return "cache";
+    }
+    return "unknown";
+}
+
+// The planner's choice for one query; explain() fills in the actuals
+struct QueryPlan {
+    AccessPath path = AccessPath::Scan;
+    std::string strategy;       // access_path_name(path), for JS
+    std::string column;         // sfi_scope_name() of the column Scan and Postings read
+    double estimated_rows = 0;  // From per-value cardinalities, assuming independent attributes
+    double estimated_cost = 0;  // Relative units, roughly SFI tests
+    double scan_cost = 0;       // Cost of each alternative considered; 0 = not available
+    double dictionary_cost = 0;
+    double postings_cost = 0;
+    uint32_t actual_rows = 0;
+    double elapsed_ms = 0;
+};
+
+#endif // COMPILED_QUERY_H
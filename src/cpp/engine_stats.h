@@ -0,0 +1,53 @@
+#ifndef ENGINE_STATS_H
+#define ENGINE_STATS_H
+
+#include <chrono>
+#include <cstdint>
+
+// Engine counters and per-phase timings, returned by PrimeKit::get_stats().
+// "last_*" fields describe the most recent load or query; "total_*" fields
+// accumulate until reset_stats(). Times are milliseconds.
+struct EngineStats {
+    // --- Last initializeFromJson ---
+    double last_parse_ms = 0;        // JSON text -> SFI columns, parsed and encoded in one pass
+    double last_encode_ms = 0;       // Clustering and index builds after the pass
+    uint64_t last_skus_loaded = 0;
+    uint64_t last_distinct_sfis = 0;        // Distinct SFIs (dictionary codes) after the load
+    uint32_t last_sfi_width_bits = 0;       // SFI column width chosen for the load: 16, 32 or 64
+    uint64_t last_overflowed_skus = 0;      // Dropped: SFI would exceed 64 bits
+    uint64_t last_invalid_items = 0;        // Dropped: missing "id" / "attributes"
+    uint64_t last_missing_prime_values = 0; // Values of schema attributes that have no prime (ignored)
+
+    // --- Last perform_filter ---
+    double last_scan_ms = 0;         // Finding matching ordinals
+    double last_materialize_ms = 0;  // Building the result vector
+    uint64_t last_skus_scanned = 0;  // SFIs tested: rows, or distinct SFIs on the dictionary path
+    uint64_t last_blocks_skipped = 0; // Row-scan blocks ruled out by the zone map
+    uint64_t last_matches = 0;
+    // Heap allocations the query made for engine-owned memory: scratch and
+    // ResultBuffer growth (one per buffer that grew) plus one per result
+    // cached. 0 once a perform_filter_into caller's buffers are warm; the
+    // vectors perform_filter returns are not counted.
+    uint64_t last_allocations = 0;
+
+    // --- Cumulative ---
+    uint64_t loads = 0;
+    uint64_t queries = 0;
+    uint64_t total_skus_scanned = 0;
+    uint64_t total_matches = 0;
+    uint64_t total_blocks_skipped = 0;
+    uint64_t cache_hits = 0;         // Queries answered from a cached result
+    uint64_t total_allocations = 0;
+    double total_parse_ms = 0;
+    double total_encode_ms = 0;
+    double total_scan_ms = 0;
+    double total_materialize_ms = 0;
+};
+
+using StatsClock = std::chrono::steady_clock;
+
+inline double elapsed_ms(StatsClock::time_point from, StatsClock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+#endif // ENGINE_STATS_H
@@ -0,0 +1,233 @@
+#include "catalog_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// Value names from generate_inventory.py, used when an attribute has one of these names
+const std::vector<std::string> kColors = {"Red", "Blue", "Green", "Yellow", "Black", "White",
+                                          "Orange", "Purple", "Gray", "Pink", "Brown", "Cyan"};
+const std::vector<std::string> kSizes = {"XS", "S", "M", "L", "XL", "XXL", "3XL"};
+const std::vector<std::string> kMaterials = {"Cotton", "Polyester", "Wool", "Silk", "Rayon", "Spandex Blend",
+                                             "Linen", "Denim", "Fleece", "Nylon", "Leatherette", "Corduroy"};
+
+const std::vector<std::string>* known_values(const std::string& attribute) {
+    if (attribute == "color") return &kColors;
+    if (attribute == "size") return &kSizes;
+    if (attribute == "material") return &kMaterials;
+    return nullptr;
+}
+
+std::vector<uint64_t> first_primes(size_t count) {
+    std::vector<uint64_t> primes;
+    primes.reserve(count);
+    for (uint64_t n = 2; primes.size() < count; ++n) {
+        bool is_prime = true;
+        for (uint64_t p : primes) {
+            if (p * p > n) break;
+            if (n % p == 0) {
+                is_prime = false;
+                break;
+            }
+        }
+        if (is_prime) primes.push_back(n);
+    }
+    return primes;
+}
+
+std::string brand_name(uint32_t index) {
+    // BrandA..BrandZ, then BrandAA, BrandAB, ...
+    std::string suffix;
+    uint32_t n = index + 1;
+    while (n > 0) {
+        --n;
+        suffix.insert(suffix.begin(), static_cast<char>('A' + n % 26));
+        n /= 26;
+    }
+    return "Brand" + suffix;
+}
+
+void append_json_string(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+}
+
+} // namespace
+
+CatalogConfig CatalogConfig::apparel() {
+    CatalogConfig config;
+    config.attributes = {
+        {"color", 12, 0.3},
+        {"size", 7, 0.0},
+        {"material", 12, 0.3},
+    };
+    return config;
+}
+
+std::vector<AttributeSpec> CatalogConfig::make_attributes(uint32_t count, uint32_t values, double multi_value_rate) {
+    static const char* kNames[] = {"color", "size", "material"};
+    std::vector<AttributeSpec> attributes;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name = i < 3 ? kNames[i] : "attr" + std::to_string(i);
+        attributes.push_back({name, values, multi_value_rate});
+    }
+    return attributes;
+}
+
+CatalogGenerator::CatalogGenerator(CatalogConfig config) : config_(std::move(config)) {
+    if (config_.brand_count == 0) throw std::invalid_argument("brand_count must be > 0");
+    if (config_.attributes.empty()) throw std::invalid_argument("at least one attribute is required");
+
+    for (uint32_t b = 0; b < config_.brand_count; ++b) brand_names_.push_back(brand_name(b));
+
+    size_t total_values = 0;
+    for (const auto& attr : config_.attributes) {
+        if (attr.value_count == 0) throw std::invalid_argument("attribute '" + attr.name + "' has no values");
+        const auto* known = known_values(attr.name);
+        std::vector<std::string> names;
+        for (uint32_t v = 0; v < attr.value_count; ++v) {
+            names.push_back(known && v < known->size() ? (*known)[v] : attr.name + "_" + std::to_string(v));
+        }
+        values_.push_back(std::move(names));
+        value_cdfs_.push_back(zipf_cdf(attr.value_count, config_.zipf_s));
+        total_values += attr.value_count;
+    }
+    brand_cdf_ = zipf_cdf(config_.brand_count, config_.brand_zipf_s);
+
+    // Each brand draws its own permutation of the first N primes, like BRAND_PRIMES
+    const std::vector<uint64_t> pool = first_primes(total_values);
+    std::mt19937_64 rng(config_.seed ^ 0x9E3779B97F4A7C15ull);
+    primes_.resize(config_.brand_count);
+    for (uint32_t b = 0; b < config_.brand_count; ++b) {
+        std::vector<uint64_t> shuffled = pool;
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+        size_t next = 0;
+        for (const auto& attr : config_.attributes) {
+            primes_[b].emplace_back(shuffled.begin() + next, shuffled.begin() + next + attr.value_count);
+            next += attr.value_count;
+        }
+    }
+}
+
+std::vector<double> CatalogGenerator::zipf_cdf(uint32_t n, double s) {
+    std::vector<double> cdf(n);
+    double sum = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        sum += s == 0.0 ? 1.0 : 1.0 / std::pow(static_cast<double>(i + 1), s);
+        cdf[i] = sum;
+    }
+    for (double& c : cdf) c /= sum;
+    cdf.back() = 1.0;
+    return cdf;
+}
+
+uint32_t CatalogGenerator::sample(const std::vector<double>& cdf, std::mt19937_64& rng) {
+    const double u = (rng() >> 11) * (1.0 / 9007199254740992.0); // [0, 1) with 53 random bits
+    return static_cast<uint32_t>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+}
+
+std::string CatalogGenerator::primes_json(uint32_t brand) const {
+    std::string out = "{\n  \"attribute_to_prime\": {";
+    for (size_t a = 0; a < config_.attributes.size(); ++a) {
+        out += a ? ",\n    " : "\n    ";
+        append_json_string(out, config_.attributes[a].name);
+        out += ": {";
+        for (size_t v = 0; v < values_[a].size(); ++v) {
+            if (v) out += ", ";
+            append_json_string(out, values_[a][v]);
+            out += ": " + std::to_string(primes_[brand][a][v]);
+        }
+        out += '}';
+    }
+    out += "\n  }\n}\n";
+    return out;
+}
+
+void CatalogGenerator::generate(const std::function<void(uint32_t brand, const std::string& chunk)>& sink,
+                                size_t chunk_bytes) {
+    const uint32_t brand_count = config_.brand_count;
+    std::vector<std::string> buffers(brand_count, "[");
+    std::vector<bool> first(brand_count, true);
+    for (auto& buffer : buffers) buffer.reserve(chunk_bytes + 4096);
+
+    stats_ = GeneratorStats();
+    stats_.skus_per_brand.assign(brand_count, 0);
+
+    std::mt19937_64 rng(config_.seed);
+    std::vector<uint32_t> picked;
+    char id[32];
+
+    for (size_t i = 0; i < config_.sku_count; ++i) {
+        const uint32_t brand = brand_count == 1 ? 0 : sample(brand_cdf_, rng);
+        std::string& out = buffers[brand];
+        if (!first[brand]) out += ',';
+        first[brand] = false;
+
+        std::snprintf(id, sizeof(id), "SKU%08zu", i + 1);
+        out += "{\"id\":\"";
+        out += id;
+        out += "\",\"attributes\":{\"brand\":[";
+        append_json_string(out, brand_names_[brand]);
+        out += ']';
+
+        bool multi = false;
+        uint64_t sfi = 1;
+        bool overflow = false;
+        for (size_t a = 0; a < config_.attributes.size(); ++a) {
+            const AttributeSpec& attr = config_.attributes[a];
+            picked.clear();
+            picked.push_back(sample(value_cdfs_[a], rng));
+            const uint32_t max_values = std::min<uint32_t>(config_.max_values_per_attribute, attr.value_count);
+            while (picked.size() < max_values && attr.multi_value_rate > 0 &&
+                   (rng() >> 11) * (1.0 / 9007199254740992.0) < attr.multi_value_rate) {
+                // Redraw from the same skewed distribution until distinct (bounded for tiny domains)
+                uint32_t v = sample(value_cdfs_[a], rng);
+                for (int tries = 0; tries < 8 && std::find(picked.begin(), picked.end(), v) != picked.end(); ++tries) {
+                    v = sample(value_cdfs_[a], rng);
+                }
+                if (std::find(picked.begin(), picked.end(), v) != picked.end()) break;
+                picked.push_back(v);
+            }
+            multi |= picked.size() > 1;
+
+            out += ',';
+            append_json_string(out, attr.name);
+            out += ":[";
+            for (size_t k = 0; k < picked.size(); ++k) {
+                if (k) out += ',';
+                append_json_string(out, values_[a][picked[k]]);
+                const uint64_t p = primes_[brand][a][picked[k]];
+                if (!overflow && sfi > UINT64_MAX / p) overflow = true;
+                if (!overflow) sfi *= p;
+            }
+            out += ']';
+        }
+        out += "}}";
+
+        ++stats_.skus_per_brand[brand];
+        if (multi) ++stats_.multi_value_skus;
+        if (overflow) ++stats_.overflowing_skus;
+
+        if (out.size() >= chunk_bytes) {
+            sink(brand, out);
+            out.clear();
+        }
+    }
+
+    for (uint32_t b = 0; b < brand_count; ++b) {
+        buffers[b] += ']';
+        sink(b, buffers[b]);
+    }
+}
+
+std::vector<std::string> CatalogGenerator::generate_inventory_json() {
+    std::vector<std::string> inventories(config_.brand_count);
+    generate([&](uint32_t brand, const std::string& chunk) { inventories[brand] += chunk; });
+    return inventories;
+}
@@ -0,0 +1,85 @@
+#ifndef CATALOG_GENERATOR_H
+#define CATALOG_GENERATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic catalog generator for benchmarks and large test inputs.
+// Produces the same layout as generate_inventory.py (one inventory array and
+// one primes.json per brand) but natively, with skewed value distributions,
+// configurable schemas and multi-value attributes. Output is deterministic
+// for a given config and seed.
+
+struct AttributeSpec {
+    std::string name;
+    uint32_t value_count = 0;
+    double multi_value_rate = 0.0; // Chance of each additional value, up to max_values_per_attribute
+};
+
+struct CatalogConfig {
+    size_t sku_count = 20000;
+    uint32_t brand_count = 3;
+    std::vector<AttributeSpec> attributes;
+    double zipf_s = 0.0;        // Attribute value skew; 0 = uniform, ~1 = typical long tail
+    double brand_zipf_s = 0.0;  // Skew of SKUs across brands
+    uint32_t max_values_per_attribute = 2;
+    uint64_t seed = 42;
+
+    // color/size/material with generate_inventory.py's value counts and multi-value rates
+    static CatalogConfig apparel();
+    // `count` generic attributes with `values` values each; the first three keep apparel names
+    static std::vector<AttributeSpec> make_attributes(uint32_t count, uint32_t values, double multi_value_rate);
+};
+
+struct GeneratorStats {
+    std::vector<size_t> skus_per_brand;
+    size_t multi_value_skus = 0;
+    size_t overflowing_skus = 0; // SKUs whose SFI would not fit in 64 bits (the engine drops these)
+};
+
+class CatalogGenerator {
+public:
+    explicit CatalogGenerator(CatalogConfig config);
+
+    const CatalogConfig& config() const { return config_; }
+    const std::vector<std::string>& brand_names() const { return brand_names_; }
+    // values()[attribute][value] -> display name
+    const std::vector<std::vector<std::string>>& values() const { return values_; }
+    // Prime of a value within a brand; each brand gets its own shuffled assignment
+    uint64_t prime(uint32_t brand, uint32_t attribute, uint32_t value) const {
+        return primes_[brand][attribute][value];
+    }
+
+    // {"attribute_to_prime": {...}} for one brand
+    std::string primes_json(uint32_t brand) const;
+
+    // Streams every brand's inventory JSON array. sink(brand, chunk) receives
+    // consecutive pieces of roughly chunk_bytes; concatenating one brand's
+    // chunks gives a complete array. Brands with no SKUs still get "[]".
+    void generate(const std::function<void(uint32_t brand, const std::string& chunk)>& sink,
+                  size_t chunk_bytes = size_t(1) << 20);
+
+    // Convenience: every brand's inventory as one string each
+    std::vector<std::string> generate_inventory_json();
+
+    // Filled by the last generate() call
+    const GeneratorStats& stats() const { return stats_; }
+
+private:
+    // Inverse-CDF sampling of a Zipf(s) rank in [0, cdf.size())
+    static uint32_t sample(const std::vector<double>& cdf, std::mt19937_64& rng);
+    static std::vector<double> zipf_cdf(uint32_t n, double s);
+
+    CatalogConfig config_;
+    std::vector<std::string> brand_names_;
+    std::vector<std::vector<std::string>> values_;
+    std::vector<std::vector<std::vector<uint64_t>>> primes_; // [brand][attribute][value]
+    std::vector<std::vector<double>> value_cdfs_;
+    std::vector<double> brand_cdf_;
+    GeneratorStats stats_;
+};
+
+#endif // CATALOG_GENERATOR_H
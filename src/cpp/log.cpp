@@ -0,0 +1,48 @@
+#include "log.h"
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+
+std::atomic<int> g_log_level{PK_LOG_COMPILE_LEVEL};
+
+const char* level_prefix(int level) {
+    switch (level) {
+        case PK_LOG_LEVEL_ERROR: return "[WASM Error] ";
+        case PK_LOG_LEVEL_WARN:  return "[WASM Warning] ";
+        case PK_LOG_LEVEL_DEBUG: return "[WASM Debug] ";
+        default:                 return "[WASM] ";
+    }
+}
+
+} // namespace
+
+void pk_set_log_level(int level) {
+    if (level < PK_LOG_LEVEL_OFF) level = PK_LOG_LEVEL_OFF;
+    if (level > PK_LOG_LEVEL_DEBUG) level = PK_LOG_LEVEL_DEBUG;
+    g_log_level.store(level, std::memory_order_relaxed);
+}
+
+int pk_log_level() {
+    return g_log_level.load(std::memory_order_relaxed);
+}
+
+void pk_log_write(int level, const char* format, ...) {
+    // One buffer and one write per line, so concurrent messages don't interleave
+    char line[1024];
+    const char* prefix = level_prefix(level);
+    int used = std::snprintf(line, sizeof(line), "%s", prefix);
+
+    va_list args;
+    va_start(args, format);
+    int written = std::vsnprintf(line + used, sizeof(line) - used - 1, format, args);
+    va_end(args);
+    if (written < 0) return;
+    size_t end = static_cast<size_t>(used) + static_cast<size_t>(written);
+    if (end > sizeof(line) - 2) end = sizeof(line) - 2; // Truncated
+    line[end] = '\n';
+    line[end + 1] = '\0';
+
+    std::fputs(line, level <= PK_LOG_LEVEL_WARN ? stderr : stdout);
+}
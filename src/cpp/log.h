@@ -0,0 +1,69 @@
+#ifndef PRIMEKIT_LOG_H
+#define PRIMEKIT_LOG_H
+
+// Level-gated logging for the engine core.
+//
+// PK_LOG_COMPILE_LEVEL (0 = off .. 4 = debug) decides which macros exist at
+// all: a call above it expands to an empty statement, so its format string
+// and arguments are never evaluated or linked. Calls at or below it are
+// additionally filtered by a runtime level (pk_set_log_level), checked before
+// any formatting. Output goes through snprintf to stdout (info/debug) or
+// stderr (warn/error), which Emscripten routes to console.log/console.error;
+// no <iostream> is pulled into the core.
+//
+// Usage: PK_LOG_WARN("Prime for [%s][%s] is not > 1", attr.c_str(), value.c_str());
+
+#include <cinttypes> // PRIu64 for callers
+
+#define PK_LOG_LEVEL_OFF   0
+#define PK_LOG_LEVEL_ERROR 1
+#define PK_LOG_LEVEL_WARN  2
+#define PK_LOG_LEVEL_INFO  3
+#define PK_LOG_LEVEL_DEBUG 4
+
+#ifndef PK_LOG_COMPILE_LEVEL
+#define PK_LOG_COMPILE_LEVEL PK_LOG_LEVEL_INFO
+#endif
+
+// Runtime threshold; messages above it are dropped. Defaults to
+// PK_LOG_COMPILE_LEVEL, so raising it past that has no effect.
+void pk_set_log_level(int level);
+int pk_log_level();
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void pk_log_write(int level, const char* format, ...);
+
+#define PK_LOG_AT(level, ...)                                  \
+    do {                                                       \
+        if ((level) <= pk_log_level()) pk_log_write((level), __VA_ARGS__); \
+    } while (0)
+
+#define PK_LOG_DISABLED(...) do { } while (0)
+
+#if PK_LOG_COMPILE_LEVEL >= PK_LOG_LEVEL_ERROR
+#define PK_LOG_ERROR(...) PK_LOG_AT(PK_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define PK_LOG_ERROR(...) PK_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if PK_LOG_COMPILE_LEVEL >= PK_LOG_LEVEL_WARN
+#define PK_LOG_WARN(...) PK_LOG_AT(PK_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define PK_LOG_WARN(...) PK_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if PK_LOG_COMPILE_LEVEL >= PK_LOG_LEVEL_INFO
+#define PK_LOG_INFO(...) PK_LOG_AT(PK_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define PK_LOG_INFO(...) PK_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if PK_LOG_COMPILE_LEVEL >= PK_LOG_LEVEL_DEBUG
+#define PK_LOG_DEBUG(...) PK_LOG_AT(PK_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define PK_LOG_DEBUG(...) PK_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#endif // PRIMEKIT_LOG_H
@@ -0,0 +1,30 @@
+#include "posting_index.h"
+#include <algorithm>
+
+void PostingIndex::clear() {
+    lists_.clear();
+    sorted_.clear();
+    cardinality_.clear();
+}
+
+void PostingIndex::reset(uint32_t value_count) {
+    clear();
+    lists_.resize(value_count);
+    sorted_.assign(value_count, 1);
+    cardinality_.assign(value_count, 0);
+}
+
+void PostingIndex::add(uint32_t value_id, uint32_t ordinal) {
+    auto& list = lists_[value_id];
+    if (!list.empty() && ordinal <= list.back()) sorted_[value_id] = 0;
+    list.push_back(ordinal);
+    ++cardinality_[value_id];
+}
+
+void PostingIndex::sort(uint32_t value_id) {
+    if (sorted_[value_id]) return;
+    auto& list = lists_[value_id];
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    sorted_[value_id] = 1;
+}
@@ -0,0 +1,49 @@
+#ifndef POSTING_INDEX_H
+#define POSTING_INDEX_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Per-value posting lists and live-row cardinalities for a segment.
+//
+// For every value id (PrimeFactorTable entry index) the index keeps the
+// ordinals of rows carrying that value, plus an exact count of live rows
+// carrying it. The counts feed the query planner's selectivity estimates;
+// the lists let a selective query visit only the rows of its rarest value.
+//
+// Updates only append: a re-encoded row is added to its new values' lists and
+// left in its old ones, and removed rows stay listed. Lists are therefore a
+// superset of the live rows, and whoever reads them re-checks each row's SFI.
+// Appending a smaller ordinal than the list's last marks it unsorted; it is
+// sorted (and de-duplicated) on first use. Compaction rebuilds everything.
+class PostingIndex {
+public:
+    void clear();
+    // Drops all lists and sizes the index for value_count value ids
+    void reset(uint32_t value_count);
+
+    bool enabled() const { return !lists_.empty(); }
+    size_t value_count() const { return lists_.size(); }
+
+    // Appends a row to a value's list and counts it as live
+    void add(uint32_t value_id, uint32_t ordinal);
+    // Counts a row as no longer carrying the value (its list entry stays until compaction)
+    void release(uint32_t value_id) { --cardinality_[value_id]; }
+
+    uint32_t cardinality(uint32_t value_id) const { return cardinality_[value_id]; }
+    // Entries in the list, including stale ones: the cost of walking it
+    size_t list_size(uint32_t value_id) const { return lists_[value_id].size(); }
+
+    bool is_sorted(uint32_t value_id) const { return sorted_[value_id] != 0; }
+    // Sorts and de-duplicates one list; callers serialize this per segment
+    void sort(uint32_t value_id);
+    const std::vector<uint32_t>& list(uint32_t value_id) const { return lists_[value_id]; }
+
+private:
+    std::vector<std::vector<uint32_t>> lists_;
+    std::vector<uint8_t> sorted_;
+    std::vector<uint32_t> cardinality_;
+};
+
+#endif // POSTING_INDEX_H
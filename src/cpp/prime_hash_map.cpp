@@ -0,0 +1,79 @@
+#include "prime_hash_map.h"
+#include <algorithm>
+#include <cstring>
+
+void PrimeHashMap::clear() {
+    attributes_.clear();
+    buckets_.clear();
+    values_.clear();
+    size_ = 0;
+}
+
+uint64_t PrimeHashMap::hash(uint32_t slot, std::string_view value) {
+    // FNV-1a over the value, seeded with the slot, then a final mix so the
+    // low bits used for the bucket index depend on every input byte
+    uint64_t h = 14695981039346656037ull ^ (uint64_t(slot) * 0x9E3779B97F4A7C15ull);
+    for (unsigned char c : value) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+void PrimeHashMap::build(const std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>>& prime_map) {
+    clear();
+
+    for (const auto& [attr_key, values] : prime_map) {
+        if (!values.empty()) attributes_.push_back(attr_key);
+    }
+    std::sort(attributes_.begin(), attributes_.end());
+
+    size_t value_count = 0;
+    for (const auto& [attr_key, values] : prime_map) value_count += values.size();
+    size_t bucket_count = 16;
+    while (bucket_count < value_count * 2) bucket_count *= 2;
+    buckets_.assign(bucket_count, Bucket());
+    const size_t mask = bucket_count - 1;
+
+    for (uint32_t slot = 0; slot < attributes_.size(); ++slot) {
+        for (const auto& [value, prime] : prime_map.at(attributes_[slot])) {
+            if (prime <= 1) continue;
+            const uint64_t h = hash(slot, value);
+            size_t i = h & mask;
+            while (buckets_[i].prime != 0) i = (i + 1) & mask; // Keys are unique: no match to check for
+            Bucket& bucket = buckets_[i];
+            bucket.hash = h;
+            bucket.prime = prime;
+            bucket.slot = slot;
+            bucket.value_offset = static_cast<uint32_t>(values_.size());
+            bucket.value_length = static_cast<uint32_t>(value.size());
+            values_ += value;
+            ++size_;
+        }
+    }
+}
+
+uint32_t PrimeHashMap::attribute_slot(std::string_view attribute) const {
+    // A handful of attributes per schema: a scan beats hashing the key
+    for (uint32_t slot = 0; slot < attributes_.size(); ++slot) {
+        if (attributes_[slot] == attribute) return slot;
+    }
+    return kNoSlot;
+}
+
+uint64_t PrimeHashMap::prime(uint32_t slot, std::string_view value) const {
+    if (buckets_.empty()) return 1;
+    const uint64_t h = hash(slot, value);
+    const size_t mask = buckets_.size() - 1;
+    for (size_t i = h & mask; buckets_[i].prime != 0; i = (i + 1) & mask) {
+        const Bucket& bucket = buckets_[i];
+        if (bucket.hash == h && bucket.slot == slot && bucket.value_length == value.size() &&
+            std::memcmp(values_.data() + bucket.value_offset, value.data(), value.size()) == 0) {
+            return bucket.prime;
+        }
+    }
+    return 1;
+}
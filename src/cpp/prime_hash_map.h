@@ -0,0 +1,57 @@
+#ifndef PRIME_HASH_MAP_H
+#define PRIME_HASH_MAP_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Frozen (attribute, value) -> prime lookup, built once per primes.json.
+//
+// Attributes are numbered with small slot ids (sorted by name), which callers
+// resolve once per attribute key and then reuse for every value under it.
+// Values live in a single open-addressing table keyed by (slot, value): one
+// hash, then a linear probe over a flat bucket array whose value bytes sit
+// in one contiguous buffer. Nothing is allocated or rehashed after build().
+class PrimeHashMap {
+public:
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    void clear();
+    // Builds the table from the attribute -> value -> prime map; primes <= 1 are skipped
+    void build(const std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>>& prime_map);
+
+    // Slot id of an attribute, kNoSlot if the schema has no values for it
+    uint32_t attribute_slot(std::string_view attribute) const;
+    // Prime of a value under the attribute in `slot`, 1 if unknown (neutral in an SFI)
+    uint64_t prime(uint32_t slot, std::string_view value) const;
+    uint64_t prime(std::string_view attribute, std::string_view value) const {
+        const uint32_t slot = attribute_slot(attribute);
+        return slot == kNoSlot ? 1 : prime(slot, value);
+    }
+
+    const std::vector<std::string>& attributes() const { return attributes_; }
+    // Slots run from 0 to slot_count() - 1
+    uint32_t slot_count() const { return static_cast<uint32_t>(attributes_.size()); }
+    size_t size() const { return size_; }
+
+private:
+    static uint64_t hash(uint32_t slot, std::string_view value);
+
+    struct Bucket {
+        uint64_t hash = 0;
+        uint64_t prime = 0;      // 0 = empty bucket
+        uint32_t slot = 0;
+        uint32_t value_offset = 0; // Into values_
+        uint32_t value_length = 0;
+    };
+
+    std::vector<std::string> attributes_; // Indexed by slot
+    std::vector<Bucket> buckets_;         // Power-of-two size, at most half full
+    std::string values_;                  // Value bytes of every bucket, back to back
+    size_t size_ = 0;
+};
+
+#endif // PRIME_HASH_MAP_H
@@ -0,0 +1,54 @@
+#include "prime_table.h"
+#include <algorithm>
+#include <numeric>
+
+void PrimeFactorTable::clear() {
+    attributes_.clear();
+    entries_.clear();
+    divisors_.clear();
+    pairwise_coprime_ = true;
+}
+
+void PrimeFactorTable::build(const std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>>& prime_map) {
+    clear();
+
+    for (const auto& [attr_key, values] : prime_map) {
+        uint32_t attribute_index = static_cast<uint32_t>(attributes_.size());
+        attributes_.push_back(attr_key);
+        for (const auto& [value, prime] : values) {
+            if (prime > 1) {
+                entries_.push_back({prime, attribute_index, value});
+            }
+        }
+    }
+
+    // Ascending primes: small factors are the most likely and cheapest to strip,
+    // and the early exit in factor() relies on this order.
+    std::sort(entries_.begin(), entries_.end(), [this](const PrimeEntry& a, const PrimeEntry& b) {
+        if (a.prime != b.prime) return a.prime < b.prime;
+        const std::string& a_attr = attributes_[a.attribute_index];
+        const std::string& b_attr = attributes_[b.attribute_index];
+        return a_attr != b_attr ? a_attr < b_attr : a.value < b.value;
+    });
+    // A prime shared by two values cannot be decoded unambiguously; keep the first
+    // in (attribute, value) order so the choice does not depend on hash order.
+    entries_.erase(std::unique(entries_.begin(), entries_.end(), [](const PrimeEntry& a, const PrimeEntry& b) {
+        return a.prime == b.prime;
+    }), entries_.end());
+
+    divisors_.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        divisors_.push_back(FastDivisor::make(entry.prime));
+    }
+
+    // Real primes.json files hold distinct primes, but the loader only checks > 1
+    pairwise_coprime_ = entries_.size() <= kCoprimeCheckLimit;
+    for (size_t i = 0; pairwise_coprime_ && i < entries_.size(); ++i) {
+        for (size_t j = i + 1; j < entries_.size(); ++j) {
+            if (std::gcd(entries_[i].prime, entries_[j].prime) != 1) {
+                pairwise_coprime_ = false;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef PRIME_TABLE_H
+#define PRIME_TABLE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Divisibility test by a fixed divisor without a hardware divide.
+// The divisor is split into odd * 2^shift; for the odd part we precompute its
+// multiplicative inverse mod 2^64, so `n % d == 0` becomes one multiply and
+// one compare, and the quotient falls out of the same multiply.
+struct FastDivisor {
+    uint64_t divisor = 1;
+    uint64_t inverse = 1;                 // Inverse of the odd part mod 2^64
+    uint64_t limit = UINT64_MAX;          // UINT64_MAX / odd part
+    uint64_t low_mask = 0;                // Bits that must be zero (2^shift - 1)
+    uint32_t shift = 0;
+
+    static FastDivisor make(uint64_t d) {
+        FastDivisor fd;
+        if (d == 0) return fd; // Caller must never test against zero
+        fd.divisor = d;
+        while ((d & 1) == 0) {
+            d >>= 1;
+            ++fd.shift;
+        }
+        uint64_t x = d; // Correct to 3 bits for odd d; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) x *= 2 - d * x;
+        fd.inverse = x;
+        fd.limit = UINT64_MAX / d;
+        fd.low_mask = fd.shift ? ((uint64_t(1) << fd.shift) - 1) : 0;
+        return fd;
+    }
+
+    bool divides(uint64_t n) const {
+        return (n & low_mask) == 0 && (n >> shift) * inverse <= limit;
+    }
+
+    // Only meaningful when divides(n) is true
+    uint64_t quotient(uint64_t n) const {
+        return (n >> shift) * inverse;
+    }
+};
+
+// One attribute value of the segment's prime dictionary
+struct PrimeEntry {
+    uint64_t prime;
+    uint32_t attribute_index; // Index into PrimeFactorTable::attributes()
+    std::string value;
+};
+
+// Reverse prime table: maps the segment's primes back to (attribute, value)
+// pairs and factors SFIs by trial division over them, smallest prime first.
+class PrimeFactorTable {
+public:
+    void clear();
+
+    // Builds the table from the attribute -> value -> prime map
+    void build(const std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>>& prime_map);
+
+    // Calls on_factor(entry_index) once for each table prime dividing `sfi`.
+    // Returns the unfactored remainder (1 when the SFI was fully decoded).
+    template <typename OnFactor>
+    uint64_t factor(uint64_t sfi, OnFactor&& on_factor) const {
+        if (sfi == 0) return 0;
+        for (uint32_t i = 0; i < divisors_.size() && sfi > 1; ++i) {
+            const FastDivisor& fd = divisors_[i];
+            if (sfi < fd.divisor) break; // Remainder is smaller than every prime left
+            if (!fd.divides(sfi)) continue;
+            do {
+                sfi = fd.quotient(sfi);
+            } while (fd.divides(sfi)); // Tolerate repeated values in the source data
+            on_factor(i);
+        }
+        return sfi;
+    }
+
+    const std::vector<PrimeEntry>& entries() const { return entries_; }
+    const std::vector<std::string>& attributes() const { return attributes_; }
+    bool empty() const { return entries_.empty(); }
+
+    // True when no two table primes share a factor (checked at build; tables
+    // above kCoprimeCheckLimit entries are not checked and report false).
+    // Only then does "prime p divides the SFI" mean "factor() reports p's
+    // entry", which presence summaries such as zone maps rely on.
+    bool pairwise_coprime() const { return pairwise_coprime_; }
+    static constexpr size_t kCoprimeCheckLimit = 1024;
+
+private:
+    std::vector<std::string> attributes_;
+    std::vector<PrimeEntry> entries_;     // Sorted by prime, ascending
+    std::vector<FastDivisor> divisors_;   // Parallel to entries_
+    bool pairwise_coprime_ = true;
+};
+
+#endif // PRIME_TABLE_H
@@ -1,12 +1,17 @@
 #include "primekit.h"
-#include <emscripten/bind.h>
-#include <iostream> // For potential debugging
-#include <numeric>  // Not strictly needed for this impl, but useful potentially
+#include "query_cursor.h"
+#include "log.h"
+#include <numeric>  // std::iota, std::partial_sum, std::gcd
 #include <limits>   // For UINT64_MAX
 #include <stdexcept> // For exceptions
 #include "nlohmann/json.hpp" // Use standard include path managed by CMake
 #include <cstdint> // For uint64_t
 #include <cmath> // For std::pow
+#include <algorithm> // For std::sort
+#include <unordered_set>
+#include <cctype>
+#include <cstdio>  // std::snprintf, for page cursors
+#include <type_traits>
 
 // Use the nlohmann json namespace
 using json = nlohmann::json;
@@ -14,254 +19,2041 @@ using json = nlohmann::json;
 // --- PrimeKit Implementation ---
 
 // Constructor is now simpler, prime maps loaded separately
-PrimeKit::PrimeKit() {
-    std::cout << "[WASM] PrimeKit constructed. Ready to load primes and inventory." << std::endl;
+PrimeKit::PrimeKit()
+    : segment_(std::make_shared<Segment>()),
+      schema_(std::make_shared<PrimeSchema>()) {
+    segment_->schema = schema_;
+    PK_LOG_INFO("PrimeKit constructed. Ready to load primes and inventory.");
 }
 
 PrimeKit::~PrimeKit() {
-    std::cout << "[WASM] PrimeKit destructed." << std::endl;
+    PK_LOG_INFO("PrimeKit destructed.");
+}
+
+// Reads an optional list of attribute names ("master_attributes" / "local_attributes")
+static std::unordered_set<std::string> attribute_list(const json& primes_json, const char* section) {
+    std::unordered_set<std::string> names;
+    if (!primes_json.contains(section)) return names;
+    const auto& list = primes_json[section];
+    if (!list.is_array()) {
+        throw std::runtime_error(std::string("Invalid primes JSON format: '") + section + "' is not an array.");
+    }
+    for (const auto& name : list) {
+        if (name.is_string()) names.insert(name.get<std::string>());
+    }
+    return names;
 }
 
 // New method to load primes from a JSON string
 void PrimeKit::initializePrimesFromJson(const std::string& json_string) {
-    std::cout << "[WASM] Parsing primes JSON... Got string length: " << json_string.length() << std::endl;
-    attribute_prime_map.clear(); // Clear previous primes
+    PK_LOG_INFO("Parsing primes JSON... Got string length: %zu", json_string.length());
+    // Build into a fresh schema; the current one stays in use if this throws
+    auto schema = std::make_shared<PrimeSchema>();
+    std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> attribute_prime_map;
 
     try {
         json primes_json = json::parse(json_string);
-        std::cout << "[WASM] Parsed JSON successfully. Checking sections..." << std::endl;
+        PK_LOG_DEBUG("Parsed JSON successfully. Checking sections...");
 
         if (primes_json.contains("attribute_to_prime")) {
-            std::cout << "[WASM] Found attribute_to_prime section." << std::endl;
+            PK_LOG_DEBUG("Found attribute_to_prime section.");
             const auto& attributes = primes_json["attribute_to_prime"];
             if (attributes.is_object()) {
-                std::cout << "[WASM] Iterating attributes..." << std::endl;
+                PK_LOG_DEBUG("Iterating attributes...");
                 for (auto const& [attr_key, attr_values] : attributes.items()) {
-                    std::cout << "[WASM]   Attr Key: " << attr_key << std::endl;
+                    PK_LOG_DEBUG("  Attr Key: %s", attr_key.c_str());
                     if (attr_values.is_object()) {
-                         std::cout << "[WASM]     Iterating values for " << attr_key << "..." << std::endl;
+                        PK_LOG_DEBUG("    Iterating values for %s...", attr_key.c_str());
                         for (auto const& [val_key, prime_val] : attr_values.items()) {
                             if (prime_val.is_number_unsigned()) {
                                 uint64_t prime = prime_val.get<uint64_t>();
-                                std::cout << "[WASM]       Value Key: " << val_key << ", Raw Prime: " << prime << std::endl;
+                                PK_LOG_DEBUG("      Value Key: %s, Raw Prime: %" PRIu64, val_key.c_str(), prime);
                                 if (prime > 1) { // Basic prime check (ensure it's not 1)
                                     attribute_prime_map[attr_key][val_key] = prime;
-                                     std::cout << "[WASM]         -> Stored Prime: " << prime << std::endl;
                                 } else {
-                                    std::cerr << "[WASM Warning] Prime value for [" << attr_key << "][" << val_key << "] is not > 1. Skipping." << std::endl;
+                                    PK_LOG_WARN("Prime value for [%s][%s] is not > 1. Skipping.", attr_key.c_str(), val_key.c_str());
                                 }
                             } else {
-                                std::cerr << "[WASM Warning] Prime value for [" << attr_key << "][" << val_key << "] is not an unsigned integer. Skipping." << std::endl;
+                                PK_LOG_WARN("Prime value for [%s][%s] is not an unsigned integer. Skipping.", attr_key.c_str(), val_key.c_str());
                             }
                         }
                     } else {
-                         std::cerr << "[WASM Warning] Value map for attribute '" << attr_key << "' is not an object. Skipping." << std::endl;
+                        PK_LOG_WARN("Value map for attribute '%s' is not an object. Skipping.", attr_key.c_str());
                     }
                 }
             } else {
-                 std::cerr << "[WASM Error] 'attribute_to_prime' section is not an object." << std::endl;
+                PK_LOG_ERROR("'attribute_to_prime' section is not an object.");
             }
         } else {
-            std::cerr << "[WASM Error] Required section 'attribute_to_prime' not found in primes JSON." << std::endl;
+            PK_LOG_ERROR("Required section 'attribute_to_prime' not found in primes JSON.");
             throw std::runtime_error("Invalid primes JSON format: missing 'attribute_to_prime' section.");
         }
 
-        std::cout << "[WASM] Successfully parsed primes JSON. Attributes found: " << attribute_prime_map.size() << std::endl;
+        schema->primes.build(attribute_prime_map);
+        StaticEncoder<ApparelVocabulary> apparel_encoder;
+        if (apparel_encoder.bind(attribute_prime_map)) {
+            schema->apparel_encoder = apparel_encoder;
+            PK_LOG_INFO("Primes match the compiled-in apparel vocabulary; using its static encoder.");
+        }
+        schema->prime_table.build(attribute_prime_map);
+
+        // Master/local split: which attributes are shared across brands and
+        // which are brand-specific. Encoding looks sides up by slot, queries
+        // by value id.
+        schema->split = primes_json.contains("master_attributes") || primes_json.contains("local_attributes");
+        if (schema->split) {
+            const auto master = attribute_list(primes_json, "master_attributes");
+            const auto local = attribute_list(primes_json, "local_attributes");
+            size_t master_count = 0;
+            for (const auto& [attr_key, values] : attribute_prime_map) {
+                if (master.count(attr_key) && local.count(attr_key)) {
+                    throw std::runtime_error("Attribute '" + attr_key + "' is listed as both master and local.");
+                }
+                if (master.count(attr_key)) {
+                    ++master_count;
+                } else if (!local.count(attr_key)) {
+                    PK_LOG_WARN("Attribute '%s' is in neither master_attributes nor local_attributes; treating it as local.",
+                                attr_key.c_str());
+                }
+            }
+            schema->with_lookup([&](const auto& lookup) {
+                for (const auto& [attr_key, values] : attribute_prime_map) {
+                    const uint32_t slot = lookup.attribute_slot(attr_key);
+                    if (slot == std::decay_t<decltype(lookup)>::kNoSlot) continue;
+                    if (slot >= schema->local_slots.size()) schema->local_slots.resize(slot + 1, 0);
+                    schema->local_slots[slot] = master.count(attr_key) ? 0 : 1;
+                }
+            });
+            const auto& attribute_names = schema->prime_table.attributes();
+            for (const PrimeEntry& entry : schema->prime_table.entries()) {
+                schema->local_values.push_back(master.count(attribute_names[entry.attribute_index]) ? 0 : 1);
+            }
+            PK_LOG_INFO("Schema splits attributes: %zu master, %zu local.", master_count,
+                        attribute_prime_map.size() - master_count);
+        }
+        std::atomic_store(&schema_, std::shared_ptr<const PrimeSchema>(std::move(schema)));
+        PK_LOG_INFO("Successfully parsed primes JSON. Attributes found: %zu", attribute_prime_map.size());
 
     } catch (json::parse_error& e) {
-        std::cerr << "[WASM Error] Failed to parse primes JSON: " << e.what() << std::endl;
+        PK_LOG_ERROR("Failed to parse primes JSON: %s", e.what());
         throw std::runtime_error("Failed to parse primes JSON.");
     } catch (std::exception& e) {
-        std::cerr << "[WASM Error] Error processing primes: " << e.what() << std::endl;
+        PK_LOG_ERROR("Error processing primes: %s", e.what());
          throw std::runtime_error("Error processing primes.");
     }
 }
 
-// Helper to get prime, returns 1 (neutral element for multiplication) if not found
-uint64_t PrimeKit::get_prime(const PrimeDictionary& dict, const std::string& key, const std::string& value) {
-    auto key_it = dict.find(key);
-    if (key_it != dict.end()) {
-        auto value_it = key_it->second.find(value);
-        if (value_it != key_it->second.end()) {
-            // Basic check: ensure prime is actually greater than 1
-            if (value_it->second > 1) {
-                return value_it->second;
+// Problems counted while encoding an inventory (reported in EngineStats)
+struct LoadCounters {
+    uint64_t overflowed_skus = 0;
+    uint64_t invalid_items = 0;
+    uint64_t missing_prime_values = 0;
+};
+
+// The SKU encoder behind loads, upserts and deltas. Takes one SKU's values
+// as they arrive and multiplies each known value's prime into the product
+// for its attribute; finish() combines those into the SFI and its master
+// and local parts. A repeated attribute key starts its product over, since
+// a JSON object keeps only the last of duplicate keys. Instantiated per
+// lookup (runtime PrimeHashMap or a compile-time StaticEncoder), so the
+// per-value lookup inlines either way.
+template <typename PrimeLookup>
+class SkuEncoder {
+public:
+    static constexpr uint32_t kNoSlot = PrimeLookup::kNoSlot;
+
+    SkuEncoder(const PrimeSchema& schema, const PrimeLookup& primes)
+        : schema_(schema), primes_(primes), products_(primes.slot_count(), 1) {}
+
+    // Starts an attribute of the current SKU; returns the slot to pass to
+    // value(), or kNoSlot if the attribute is not encoded
+    uint32_t attribute(std::string_view key) {
+        // IMPORTANT: Skip 'brand' attribute for SFI calculation
+        if (key == "brand") return kNoSlot;
+        const uint32_t slot = primes_.attribute_slot(key);
+        if (slot == kNoSlot) return kNoSlot; // Attribute type not in our prime map
+        if (std::find(touched_.begin(), touched_.end(), slot) == touched_.end()) touched_.push_back(slot);
+        products_[slot] = 1;
+        return slot;
+    }
+
+    void value(uint32_t slot, std::string_view value) {
+        const uint64_t prime = primes_.prime(slot, value);
+        if (prime <= 1) {
+            ++missing_prime_values; // Value not found in prime map - ignored for SFI
+            return;
+        }
+        uint64_t& product = products_[slot];
+        product = product == 0 || product > UINT64_MAX / prime ? 0 : product * prime; // 0: overflowed
+    }
+
+    // Ends the current SKU. Returns false if its SFI would overflow 64 bits.
+    bool finish(EncodedSfi& encoded) {
+        encoded = EncodedSfi();
+        bool fits = true;
+        for (uint32_t slot : touched_) {
+            const uint64_t product = products_[slot];
+            products_[slot] = 1;
+            if (!fits) continue;
+            if (product == 0 || encoded.sfi > UINT64_MAX / product) {
+                fits = false; // The parts divide the SFI, so they fit whenever it does
+                continue;
             }
+            encoded.sfi *= product;
+            (schema_.is_local_slot(slot) ? encoded.local : encoded.master) *= product;
         }
+        touched_.clear();
+        return fits;
     }
-    // Optional: Add warning/error logging here if a prime is missing
-    // std::cerr << "Warning: Prime not found or invalid for key: " << key << ", value: " << value << std::endl;
-    return 1; // Return 1 if attribute or value is not found or invalid
-}
 
-// Encodes SFI based on selected attributes and primes (handles multi-value)
-uint64_t PrimeKit::encode_sfi(const ItemAttributes& attributes, const std::vector<std::string>& relevant_keys, const PrimeDictionary& prime_dict) {
-    uint64_t sfi = 1;
-    const uint64_t max_val = std::numeric_limits<uint64_t>::max();
+    uint64_t missing_prime_values = 0;
 
-    for (const std::string& key : relevant_keys) { // e.g., key = "color"
-        auto attr_it = attributes.find(key);
-        if (attr_it != attributes.end()) {
-            // attr_it->second is now a std::vector<std::string>, e.g., ["Red", "Blue"]
-            for (const std::string& value : attr_it->second) { // Iterate through values ("Red", then "Blue")
-                uint64_t prime = get_prime(prime_dict, key, value); // Get prime for "Red", then prime for "Blue"
+private:
+    const PrimeSchema& schema_;
+    const PrimeLookup& primes_;
+    std::vector<uint64_t> products_; // By slot; 1 = no values yet
+    std::vector<uint32_t> touched_;  // Slots the current SKU has products in
+};
 
-                if (prime > 1) {
-                    // Check for potential overflow before multiplying
-                    if (sfi > max_val / prime) {
-                        std::cerr << "ERROR: SFI overflow detected during encoding! Key: " << key
-                                  << ", Value: " << value << ", Prime: " << prime
-                                  << ", Current SFI: " << sfi << std::endl;
-                        return 1; // Indicate error/invalid SFI
-                    }
-                    sfi *= prime; // Multiply the prime into the SFI
-                }
-            } // End loop through values for this key
-        }
-        // else: Optional warning if key (e.g. "color") is missing entirely
-    } // End loop through relevant keys
-    return sfi;
+template <typename PrimeLookup>
+static bool encode_attributes(const PrimeSchema& schema, const PrimeLookup& primes, const ItemAttributes& attributes,
+                              EncodedSfi& encoded) {
+    SkuEncoder<PrimeLookup> encoder(schema, primes);
+    for (const auto& [attr_key, values] : attributes) {
+        const uint32_t slot = encoder.attribute(attr_key);
+        if (slot == encoder.kNoSlot) continue;
+        for (const std::string& value : values) encoder.value(slot, value);
+    }
+    return encoder.finish(encoded);
 }
 
-// Processes a single item's raw data to calculate its SFIs
-// Note: This method isn't directly exposed to JS in this version
-std::tuple<uint64_t, uint64_t> PrimeKit::process_item_attributes(const ItemAttributes& item_attributes) {
-    uint64_t master_sfi = encode_sfi(item_attributes, master_attribute_keys_, master_primes_);
-    uint64_t local_sfi = encode_sfi(item_attributes, local_attribute_keys_, local_primes_);
-    // If encoding failed (overflow), the SFI will be 1
-    return std::make_tuple(master_sfi, local_sfi);
-}
+// SAX handler that encodes an inventory array straight from the JSON text
+// into a segment: no DOM is built, ids are copied once into the segment's
+// arena, and every other string is looked up where the parser left it.
+// Follows the DOM rules of earlier versions: items that are not objects or
+// lack "id" or "attributes" are counted invalid and skipped; non-array
+// attribute values and non-string entries are ignored; a non-string id
+// fails the load.
+template <typename PrimeLookup>
+class InventoryReader {
+public:
+    InventoryReader(const PrimeSchema& schema, const PrimeLookup& primes, Segment& segment, LoadCounters& counters)
+        : encoder_(schema, primes), segment_(segment), counters_(counters) {}
 
-// Initializes from inventory JSON string
-void PrimeKit::initializeFromJson(const std::string& json_string) {
-    std::cout << "[WASM] Parsing inventory JSON..." << std::endl;
-    internal_sku_data_.clear(); // Use correct member name
+    ~InventoryReader() { counters_.missing_prime_values += encoder_.missing_prime_values; }
 
-    try {
-        json inventory_json = json::parse(json_string);
-        if (!inventory_json.is_array()) {
-            throw std::runtime_error("Inventory JSON is not an array.");
+    // Containers. depth_ counts open containers: 1 the inventory array, 2 an
+    // item, 3 its attributes object, 4 one attribute's value array. Anything
+    // else is skipped whole.
+    bool start_object(std::size_t) { return open(true); }
+    bool start_array(std::size_t) { return open(false); }
+    bool end_object() { return close(); }
+    bool end_array() { return close(); }
+
+    bool key(std::string& key) {
+        if (skip_depth_) return true;
+        if (depth_ == 2) {
+            field_ = key == "id" ? Field::Id : key == "attributes" ? Field::Attributes : Field::Other;
+        } else if (depth_ == 3) {
+            slot_ = encoder_.attribute(key);
         }
+        return true;
+    }
 
-        internal_sku_data_.reserve(inventory_json.size()); // Use correct member name
+    bool string(std::string& value) {
+        if (skip_depth_) return true;
+        if (depth_ == 4) {
+            encoder_.value(slot_, value);
+        } else if (depth_ == 2 && field_ == Field::Id) {
+            has_id_ = true;
+            id_is_string_ = true;
+            id_.assign(value);
+        } else {
+            scalar();
+        }
+        return true;
+    }
+    bool null() { return scalar(); }
+    bool boolean(bool) { return scalar(); }
+    bool number_integer(json::number_integer_t) { return scalar(); }
+    bool number_unsigned(json::number_unsigned_t) { return scalar(); }
+    bool number_float(json::number_float_t, const std::string&) { return scalar(); }
+    bool binary(json::binary_t&) { return scalar(); }
 
-        for (const auto& item : inventory_json) {
-            if (!item.is_object() || !item.contains("id") || !item.contains("attributes")) {
-                std::cerr << "[WASM Warning] Skipping invalid inventory item format." << std::endl;
-                continue;
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) {
+        if (auto* error = dynamic_cast<const json::parse_error*>(&e)) throw *error;
+        throw std::runtime_error(e.what());
+    }
+
+private:
+    enum class Field { Other, Id, Attributes };
+
+    bool open(bool object) {
+        const int parent = depth_++;
+        if (skip_depth_) return true;
+        if (parent == 0) {
+            if (object) throw std::runtime_error("Inventory JSON is not an array.");
+        } else if (parent == 1) {
+            if (object) {
+                begin_item();
+            } else {
+                ++counters_.invalid_items; // Skipping invalid inventory item format
+                skip_depth_ = depth_;
             }
+        } else if (parent == 2 && field_ == Field::Attributes) {
+            begin_attributes();
+            if (!object) skip_depth_ = depth_; // Attributes section not an object - ignored
+        } else if (parent == 3 && !object && slot_ != encoder_.kNoSlot) {
+            // An attribute's values: read at depth 4
+        } else {
+            if (parent == 2 && field_ == Field::Id) {
+                has_id_ = true;
+                id_is_string_ = false;
+            }
+            skip_depth_ = depth_;
+        }
+        return true;
+    }
 
-            SkuData sku;
-            sku.id = item["id"].get<std::string>();
-            sku.sfi = 1;
+    bool close() {
+        if (skip_depth_ == depth_) {
+            skip_depth_ = 0;
+        } else if (!skip_depth_ && depth_ == 2) {
+            end_item();
+        }
+        --depth_;
+        return true;
+    }
 
-            const auto& attributes = item["attributes"];
-            if (attributes.is_object()) {
-                for (auto const& [attr_key, attr_values] : attributes.items()) {
-                    // IMPORTANT: Skip 'brand' attribute for SFI calculation
-                    if (attr_key == "brand") continue; 
+    // A number, bool, null or non-id string where an item, id, attributes
+    // section or attribute value array could be
+    bool scalar() {
+        if (skip_depth_) return true;
+        if (depth_ == 0) throw std::runtime_error("Inventory JSON is not an array.");
+        if (depth_ == 1) ++counters_.invalid_items; // Skipping invalid inventory item format
+        if (depth_ == 2 && field_ == Field::Id) {
+            has_id_ = true;
+            id_is_string_ = false;
+        } else if (depth_ == 2 && field_ == Field::Attributes) {
+            begin_attributes(); // Attributes section not an object - ignored
+        }
+        return true;
+    }
 
-                    if (!attribute_prime_map.count(attr_key)) {
-                        // std::cout << "[WASM Note] Skipping attribute '" << attr_key << "' for SFI calculation (no prime map)." << std::endl;
-                        continue; // Attribute type not in our prime map
-                    }
-                    const auto& prime_value_map = attribute_prime_map.at(attr_key);
-
-                    if (attr_values.is_array()) {
-                        for (const auto& val : attr_values) {
-                            if (val.is_string()) {
-                                std::string val_str = val.get<std::string>();
-                                if (prime_value_map.count(val_str)) {
-                                    uint64_t prime = prime_value_map.at(val_str);
-                                    uint64_t current_sfi = sku.sfi;
-                                    // Overflow check before multiplication
-                                    if (prime > 0 && current_sfi > UINT64_MAX / prime) {
-                                        std::cerr << "[WASM Warning] SFI overflow detected for SKU " << sku.id 
-                                                  << " while multiplying by prime " << prime << " for attribute [" << attr_key << "][" << val_str << "]! SFI will be capped." << std::endl;
-                                        sku.sfi = UINT64_MAX;
-                                        goto next_item; // Skip rest of attrs for this item if overflow
-                                    } else if (prime > 1) {
-                                        sku.sfi *= prime;
-                                    }
-                                }
-                                // else: Value not found in prime map for this attribute - ignored for SFI
-                            }
-                        }
-                    }
-                     // else: Attribute values not an array - ignored
-                }
-            } 
-            // else: Attributes section not an object - ignored
+    void begin_item() {
+        has_id_ = has_attributes_ = id_is_string_ = false;
+        field_ = Field::Other;
+    }
 
-            internal_sku_data_.push_back(sku); // Use correct member name
-        next_item:;
+    // A repeated "attributes" key replaces the earlier section
+    void begin_attributes() {
+        if (has_attributes_) encoder_.finish(discarded_);
+        has_attributes_ = true;
+    }
+
+    void end_item() {
+        EncodedSfi encoded;
+        const bool fits = encoder_.finish(encoded);
+        if (!has_id_ || !has_attributes_) {
+            ++counters_.invalid_items; // Skipping invalid inventory item format
+            return;
+        }
+        if (!id_is_string_) throw std::runtime_error("Inventory item id is not a string.");
+        if (!fits) {
+            ++counters_.overflowed_skus; // SFI overflow: the SKU cannot be represented
+            return;
         }
+        segment_.sku_data.push_back({segment_.ids.copy(id_)});
+        segment_.store_sfi(static_cast<uint32_t>(segment_.sku_data.size() - 1), encoded); // Widens columns only if needed
+    }
+
+    SkuEncoder<PrimeLookup> encoder_;
+    Segment& segment_;
+    LoadCounters& counters_;
+    EncodedSfi discarded_;
 
-        std::cout << "[WASM] Initialized PrimeKit with " << internal_sku_data_.size() << " SKUs from JSON." << std::endl; // Use correct member name
+    int depth_ = 0;
+    int skip_depth_ = 0; // Depth of the container being skipped, 0 if none
+    Field field_ = Field::Other;
+    uint32_t slot_ = 0;
+    std::string id_; // Reused across items
+    bool has_id_ = false;
+    bool id_is_string_ = false;
+    bool has_attributes_ = false;
+};
+
+// Initializes from inventory JSON string
+void PrimeKit::initializeFromJson(const std::string& json_string) {
+    // Shadow generation: built off to the side, published only on success
+    auto segment = std::make_shared<Segment>();
+    segment->schema = current_schema();
+    const PrimeSchema& schema = *segment->schema;
+    auto& sku_data = segment->sku_data;
+
+    try {
+        // Parse and encode in one streaming pass (see InventoryReader)
+        const auto parse_start = StatsClock::now();
+        LoadCounters counters;
+        schema.with_lookup([&](const auto& primes) {
+            InventoryReader<std::decay_t<decltype(primes)>> reader(schema, primes, *segment, counters);
+            json::sax_parse(json_string, &reader);
+        });
+        const auto encode_start = StatsClock::now();
+
+        if (cluster_on_load_.load()) cluster_rows(*segment);
+        rebuild_indexes(*segment);
+        segment->version = ++next_version_;
+        segment->layout_version = segment->version;
+        const auto encode_end = StatsClock::now();
+
+        // Publish: one pointer swap. Queries already running keep the old generation alive.
+        {
+            std::lock_guard<std::mutex> writer(writer_mutex_);
+            std::atomic_store(&segment_, segment);
+        }
+
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        stats_.last_parse_ms = elapsed_ms(parse_start, encode_start);
+        stats_.last_encode_ms = elapsed_ms(encode_start, encode_end);
+        stats_.last_skus_loaded = sku_data.size();
+        stats_.last_distinct_sfis = segment->dictionary.distinct_count();
+        stats_.last_sfi_width_bits = segment->sfis.width();
+        stats_.last_overflowed_skus = counters.overflowed_skus;
+        stats_.last_invalid_items = counters.invalid_items;
+        stats_.last_missing_prime_values = counters.missing_prime_values;
+        ++stats_.loads;
+        stats_.total_parse_ms += stats_.last_parse_ms;
+        stats_.total_encode_ms += stats_.last_encode_ms;
 
     } catch (json::parse_error& e) {
-        std::cerr << "[WASM Error] Failed to parse inventory JSON: " << e.what() << std::endl;
+        PK_LOG_ERROR("Failed to parse inventory JSON: %s", e.what());
         throw std::runtime_error("Failed to parse inventory JSON.");
     } catch (std::exception& e) {
-         std::cerr << "[WASM Error] Error processing inventory: " << e.what() << std::endl;
+         PK_LOG_ERROR("Error processing inventory: %s", e.what());
          throw std::runtime_error("Error processing inventory.");
     }
 }
 
+// --- Query Scratch ---
+
+size_t PrimeKit::QueryScratch::capacity_bytes() const {
+    size_t bytes = (matches.capacity() + counts.capacity() + pending.capacity()) * sizeof(uint32_t) +
+                   bitmap.capacity() * sizeof(uint64_t) + ordinals.capacity() * sizeof(std::vector<uint32_t>);
+    for (const auto& list : ordinals) bytes += list.capacity() * sizeof(uint32_t);
+    bytes += query.value_ids.capacity() * sizeof(uint32_t) + query.value_mask.capacity() * sizeof(uint64_t);
+    bytes += levels.capacity() + ranked.capacity() * sizeof(RankedRow);
+    return bytes;
+}
+
+uint64_t PrimeKit::QueryScratch::count_growth() {
+    // matches and the ordinal lists swap buffers, so they are tracked as one
+    size_t list_capacity = matches.capacity();
+    for (const auto& list : ordinals) list_capacity += list.capacity();
+    const std::array<size_t, 9> capacity = {list_capacity,      ordinals.capacity(), counts.capacity(),
+                                            pending.capacity(),  bitmap.capacity(),   query.value_ids.capacity(),
+                                            query.value_mask.capacity(), levels.capacity(), ranked.capacity()};
+    uint64_t grown = 0;
+    for (size_t i = 0; i < capacity.size(); ++i) grown += capacity[i] != seen_capacity_[i];
+    seen_capacity_ = capacity;
+    return grown;
+}
+
+std::unique_ptr<PrimeKit::QueryScratch> PrimeKit::acquire_scratch() {
+    {
+        std::lock_guard<std::mutex> lock(scratch_mutex_);
+        if (!scratch_pool_.empty()) {
+            std::unique_ptr<QueryScratch> scratch = std::move(scratch_pool_.back());
+            scratch_pool_.pop_back();
+            return scratch;
+        }
+    }
+    return std::make_unique<QueryScratch>();
+}
+
+void PrimeKit::release_scratch(std::unique_ptr<QueryScratch> scratch) {
+    if (scratch->capacity_bytes() > kScratchKeepBytes) return; // Freed here, outside the lock
+    std::lock_guard<std::mutex> lock(scratch_mutex_);
+    if (scratch_pool_.size() < kScratchPoolSize) scratch_pool_.push_back(std::move(scratch));
+}
+
+// Holds one QueryScratch for the duration of a query and hands it back to
+// the pool on every exit path
+class PrimeKit::ScratchLease {
+public:
+    explicit ScratchLease(PrimeKit& kit) : kit_(kit), scratch_(kit.acquire_scratch()) { scratch_->count_growth(); }
+    ~ScratchLease() { kit_.release_scratch(std::move(scratch_)); }
+    ScratchLease(const ScratchLease&) = delete;
+    ScratchLease& operator=(const ScratchLease&) = delete;
+
+    QueryScratch& operator*() { return *scratch_; }
+    QueryScratch* operator->() { return scratch_.get(); }
+    // Scratch buffers that grew since the lease began
+    uint64_t growth() { return scratch_->count_growth(); }
+
+private:
+    PrimeKit& kit_;
+    std::unique_ptr<QueryScratch> scratch_;
+};
+
+template <typename Materialize>
+void PrimeKit::filter_single(uint64_t query_sfi, Materialize&& materialize) {
+    auto segment = current_segment(); // Pin this generation for the whole query
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+
+    // Scan: collect matching ordinals only, so the scan loop stays tight
+    const auto scan_start = StatsClock::now();
+    ScratchLease scratch(*this);
+    compile_query(*segment, query_sfi, scratch->query);
+    std::vector<uint32_t>& matches = scratch->matches;
+    QueryPlan plan;
+    ScanCounters counters = run_query(*segment, scratch->query, matches, plan, *scratch);
+
+    // Materialize: copy ids and SFIs out for the caller
+    const auto materialize_start = StatsClock::now();
+    counters.allocations += materialize(*segment, matches);
+    const auto materialize_end = StatsClock::now();
+
+    counters.allocations += scratch.growth();
+    record_query(counters, matches.size(), elapsed_ms(scan_start, materialize_start),
+                 elapsed_ms(materialize_start, materialize_end));
+}
+
 // Filters the loaded SKUs based on query SFIs
 // Reverted to return vector<FilterResult>
 std::vector<FilterResult> PrimeKit::perform_filter(uint64_t query_sfi) {
-    std::cout << "[WASM] Filtering with Query SFI: " << query_sfi << std::endl;
     std::vector<FilterResult> matching_results;
     
     if (query_sfi == 0) { // Avoid division by zero
-        std::cerr << "[WASM Error] Query SFI cannot be zero." << std::endl;
+        PK_LOG_ERROR("Query SFI cannot be zero.");
         return matching_results; // Return empty vector
     }
-    if (query_sfi == 1) { // Optimization: If query is 1, all items match
-        matching_results.reserve(internal_sku_data_.size()); // Use correct member name
-        for (const auto& item : internal_sku_data_) { // Use correct member name
-             matching_results.push_back({item.id, item.sfi});
+
+    filter_single(query_sfi, [&](const Segment& segment, const std::vector<uint32_t>& matches) {
+        matching_results.reserve(matches.size());
+        for (uint32_t ordinal : matches) {
+            matching_results.push_back({std::string(segment.sku_data[ordinal].id), segment.sfis.get(ordinal), ordinal});
         }
-        std::cout << "[WASM] Query SFI is 1, returning all " << internal_sku_data_.size() << " SKUs." << std::endl; // Use correct member name
-        return matching_results;
+        return uint64_t(0); // The returned vector is the caller's
+    });
+    return matching_results;
+}
+
+void PrimeKit::perform_filter_into(uint64_t query_sfi, ResultBuffer& out) {
+    if (query_sfi == 0) {
+        PK_LOG_ERROR("Query SFI cannot be zero.");
+        out.begin(0);
+        out.finish();
+        return;
     }
 
-    for (const auto& item : internal_sku_data_) { // Use correct member name
-        if (item.sfi != 0 && item.sfi % query_sfi == 0) { // Check divisibility
-             matching_results.push_back({item.id, item.sfi});
+    filter_single(query_sfi, [&](const Segment& segment, const std::vector<uint32_t>& matches) {
+        const uint64_t allocations_before = out.allocations();
+        out.begin(matches.size());
+        for (uint32_t ordinal : matches) {
+            out.append(ordinal, segment.sfis.get(ordinal), segment.sku_data[ordinal].id);
         }
+        out.finish();
+        return out.allocations() - allocations_before;
+    });
+}
+
+bool PrimeKit::query_sfi_for_primes(const uint32_t* primes, size_t count, uint64_t& query_sfi) {
+    // A row matches when its SFI is divisible by every selected prime, i.e. by
+    // their lcm (the product, when the primes are distinct primes)
+    query_sfi = 1;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t prime = primes[i];
+        if (prime <= 1) continue; // "Any" selection
+        const uint64_t base = query_sfi / std::gcd(query_sfi, prime); // 1 when already covered
+        if (base > UINT64_MAX / prime) return false;
+        query_sfi = base * prime;
     }
+    return true;
+}
 
-    std::cout << "[WASM] Found " << matching_results.size() << " matching SKUs." << std::endl;
-    return matching_results;
+std::vector<FilterResult> PrimeKit::perform_filter_primes(const uint32_t* primes, size_t count) {
+    uint64_t query_sfi = 1;
+    if (!query_sfi_for_primes(primes, count, query_sfi)) return {}; // Beyond every 64-bit SFI: nothing can match
+    return perform_filter(query_sfi);
 }
 
-// --- Embind Bindings ---
+void PrimeKit::perform_filter_primes_into(const uint32_t* primes, size_t count, ResultBuffer& out) {
+    uint64_t query_sfi = 1;
+    if (!query_sfi_for_primes(primes, count, query_sfi)) {
+        out.begin(0);
+        out.finish();
+        return;
+    }
+    perform_filter_into(query_sfi, out);
+}
 
-using namespace emscripten;
+// Plans every query of a batch the way perform_filter would. Queries whose
+// plan reads the rows or the dictionary (and whose result isn't cached) go
+// into `shared`, one list per path, to share a pass; the rest are answered
+// individually by the caller.
+struct PrimeKit::BatchPlan {
+    std::vector<CompiledQuery> shared[2]; // [0] row scan, [1] dictionary
+    std::vector<size_t> shared_index[2];  // Position of each shared query in the batch
+    std::vector<QueryPlan> plans;
+};
 
-EMSCRIPTEN_BINDINGS(primekit_module) {
-    
-    // Ensure FilterResult struct is registered
-    value_object<FilterResult>("FilterResult")
-        .field("id", &FilterResult::id)
-        .field("sfi", &FilterResult::sfi)
-        ;
-
-    // Ensure vector<FilterResult> is registered
-    register_vector<FilterResult>("VectorFilterResult");
-    
-    // Keep VectorString registered (optional, no harm)
-    register_vector<std::string>("VectorString");
-
-    // Bind the PrimeKit class
-    class_<PrimeKit>("PrimeKit")
-        .constructor<>()
-        .function("initializePrimesFromJson", &PrimeKit::initializePrimesFromJson)
-        .function("initializeFromJson", &PrimeKit::initializeFromJson)
-        .function("perform_filter", &PrimeKit::perform_filter)
-        // Allow the instance to be deleted from JS, explicitly allowing raw pointer
-        .function("delete", &PrimeKit::delete_, allow_raw_pointers());
-
-} 
\ No newline at end of file
+void PrimeKit::plan_batch(const Segment& segment, const std::vector<CompiledQuery>& queries, BatchPlan& batch) {
+    batch.plans.resize(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const QueryPlan& plan = batch.plans[q] = plan_query(segment, queries[q]);
+        if (plan.path != AccessPath::Scan && plan.path != AccessPath::Dictionary) continue;
+        if (result_cache_.find(segment.version, queries[q].sfi)) continue;
+        const int pass = plan.path == AccessPath::Dictionary;
+        batch.shared[pass].push_back(queries[q]);
+        batch.shared_index[pass].push_back(q);
+    }
+}
+
+std::vector<std::vector<FilterResult>> PrimeKit::perform_filter_batch(const std::vector<uint64_t>& query_sfis) {
+    std::vector<std::vector<FilterResult>> results(query_sfis.size());
+
+    auto segment = current_segment(); // One generation for the whole batch
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    const auto& sku_data = segment->sku_data;
+    const SfiColumn& sfis = segment->sfis;
+
+    const auto scan_start = StatsClock::now();
+    std::vector<CompiledQuery> queries;
+    queries.reserve(query_sfis.size());
+    for (uint64_t query_sfi : query_sfis) {
+        if (query_sfi == 0) PK_LOG_ERROR("Query SFI cannot be zero.");
+        queries.push_back(compile_query(*segment, query_sfi));
+    }
+    ScratchLease scratch(*this);
+    BatchPlan batch;
+    plan_batch(*segment, queries, batch);
+
+    // Row-scan and dictionary queries share one pass per path, and their
+    // results are cached as run_query would; the rest run one by one. Each
+    // query is materialized straight from the scratch lists it was found in.
+    ScanCounters counters;
+    double scan_ms = 0;
+    double materialize_ms = 0;
+    uint64_t total_matches = 0;
+    auto materialize = [&](size_t q, const std::vector<uint32_t>& matches) {
+        results[q].reserve(matches.size());
+        for (uint32_t ordinal : matches) {
+            results[q].push_back({std::string(sku_data[ordinal].id), sfis.get(ordinal), ordinal});
+        }
+        total_matches += matches.size();
+    };
+    std::vector<bool> answered(queries.size(), false);
+    for (int pass = 0; pass < 2; ++pass) {
+        const std::vector<CompiledQuery>& shared = batch.shared[pass];
+        if (shared.empty()) continue;
+        counters += scan_batch(*segment, shared.data(), shared.size(), &scratch->ordinals, scratch->counts,
+                               pass == 1, *scratch);
+        for (size_t i = 0; i < shared.size(); ++i) {
+            const std::vector<uint32_t>& matches = scratch->ordinals[i];
+            if (result_cache_.admits(matches.size())) {
+                result_cache_.insert(segment->version, shared[i].sfi, std::make_shared<const std::vector<uint32_t>>(matches));
+                ++counters.allocations;
+            }
+        }
+        const auto materialize_start = StatsClock::now();
+        for (size_t i = 0; i < shared.size(); ++i) {
+            const size_t q = batch.shared_index[pass][i];
+            materialize(q, scratch->ordinals[i]);
+            answered[q] = true;
+        }
+        materialize_ms += elapsed_ms(materialize_start, StatsClock::now());
+    }
+    for (size_t q = 0; q < queries.size(); ++q) {
+        if (answered[q]) continue;
+        QueryPlan plan;
+        counters += run_query(*segment, queries[q], scratch->matches, plan, *scratch);
+        const auto materialize_start = StatsClock::now();
+        materialize(q, scratch->matches);
+        materialize_ms += elapsed_ms(materialize_start, StatsClock::now());
+    }
+    scan_ms = elapsed_ms(scan_start, StatsClock::now()) - materialize_ms;
+
+    counters.allocations += scratch.growth();
+    record_query(counters, total_matches, scan_ms, materialize_ms, query_sfis.size());
+    return results;
+}
+
+std::vector<uint32_t> PrimeKit::perform_filter_batch_counts(const std::vector<uint64_t>& query_sfis) {
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+
+    const auto scan_start = StatsClock::now();
+    std::vector<CompiledQuery> queries;
+    queries.reserve(query_sfis.size());
+    for (uint64_t query_sfi : query_sfis) {
+        if (query_sfi == 0) PK_LOG_ERROR("Query SFI cannot be zero.");
+        queries.push_back(compile_query(*segment, query_sfi));
+    }
+    ScratchLease scratch(*this);
+    BatchPlan batch;
+    plan_batch(*segment, queries, batch);
+
+    std::vector<uint32_t> counts(queries.size(), 0);
+    std::vector<bool> answered(queries.size(), false);
+    ScanCounters counters;
+    for (int pass = 0; pass < 2; ++pass) {
+        const std::vector<CompiledQuery>& shared = batch.shared[pass];
+        if (shared.empty()) continue;
+        counters += scan_batch(*segment, shared.data(), shared.size(), nullptr, scratch->counts, pass == 1, *scratch);
+        for (size_t i = 0; i < shared.size(); ++i) {
+            const size_t q = batch.shared_index[pass][i];
+            counts[q] = scratch->counts[i];
+            answered[q] = true;
+        }
+    }
+    for (size_t q = 0; q < queries.size(); ++q) {
+        if (!answered[q]) counters += count_matches(*segment, queries[q], batch.plans[q], counts[q], *scratch);
+    }
+    const auto scan_end = StatsClock::now();
+
+    uint64_t total_matches = 0;
+    for (uint32_t count : counts) total_matches += count;
+    counters.allocations += scratch.growth();
+    record_query(counters, total_matches, elapsed_ms(scan_start, scan_end), 0, query_sfis.size());
+    return counts;
+}
+
+// --- Paged Queries ---
+
+// A page cursor names the query, the catalog layout and version it was cut
+// from, the catalog position of the next page's first match and the total.
+// It travels as "p1.<hex>.<hex>.<hex>.<hex>.<hex>"; callers treat it as opaque.
+struct PageCursor {
+    uint64_t query_sfi = 0;
+    uint64_t layout_version = 0;
+    uint64_t version = 0;
+    uint64_t position = 0;
+    uint64_t total = 0;
+};
+
+static std::string format_page_cursor(const PageCursor& cursor) {
+    char text[96];
+    std::snprintf(text, sizeof(text), "p1.%" PRIx64 ".%" PRIx64 ".%" PRIx64 ".%" PRIx64 ".%" PRIx64, cursor.query_sfi,
+                  cursor.layout_version, cursor.version, cursor.position, cursor.total);
+    return text;
+}
+
+std::string PrimeKit::first_page_cursor(uint64_t query_sfi, uint64_t layout_version, uint64_t version,
+                                        uint64_t total) {
+    PageCursor cursor;
+    cursor.query_sfi = query_sfi;
+    cursor.layout_version = layout_version;
+    cursor.version = version;
+    cursor.total = total;
+    return format_page_cursor(cursor);
+}
+
+static PageCursor parse_page_cursor(const std::string& text) {
+    PageCursor cursor;
+    uint64_t* fields[] = {&cursor.query_sfi, &cursor.layout_version, &cursor.version, &cursor.position, &cursor.total};
+    if (text.compare(0, 3, "p1.") != 0) throw std::runtime_error("Invalid page cursor.");
+    const char* next = text.c_str() + 3;
+    for (size_t i = 0; i < 5; ++i) {
+        if (!std::isxdigit(static_cast<unsigned char>(*next))) throw std::runtime_error("Invalid page cursor.");
+        char* end = nullptr;
+        *fields[i] = std::strtoull(next, &end, 16);
+        if (*end != (i < 4 ? '.' : '\0')) throw std::runtime_error("Invalid page cursor.");
+        next = end + 1;
+    }
+    return cursor;
+}
+
+QueryPage PrimeKit::query_page(uint64_t query_sfi, const std::string& cursor_text, uint32_t limit, ResultBuffer& out) {
+    QueryPage page;
+    if (query_sfi == 0) {
+        PK_LOG_ERROR("Query SFI cannot be zero.");
+        out.begin(0);
+        out.finish();
+        return page;
+    }
+    const bool resume = !cursor_text.empty();
+    const PageCursor cursor = resume ? parse_page_cursor(cursor_text) : PageCursor();
+
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    if (resume && cursor.query_sfi != query_sfi) {
+        throw std::runtime_error("Page cursor belongs to a different query.");
+    }
+    if (resume && cursor.layout_version != segment->layout_version) {
+        throw std::runtime_error("Page cursor is stale: the catalog was reloaded or compacted.");
+    }
+
+    const auto scan_start = StatsClock::now();
+    ScratchLease scratch(*this);
+    compile_query(*segment, query_sfi, scratch->query);
+    const CompiledQuery& query = scratch->query;
+    const QueryPlan plan = plan_query(*segment, query);
+
+    ScanCounters counters;
+    uint32_t total = 0;
+    if (resume && cursor.version == segment->version) {
+        total = static_cast<uint32_t>(cursor.total);
+    } else {
+        counters = count_matches(*segment, query, plan, total, *scratch);
+    }
+    // One match past the page tells whether there is a next page, and where it starts
+    std::vector<uint32_t>& matches = scratch->matches;
+    matches.clear();
+    const ScanCounters walk = collect_page(*segment, query, plan, resume ? cursor.position : 0, size_t(limit) + 1, matches);
+    counters.sfis_tested += walk.sfis_tested;
+    counters.blocks_skipped += walk.blocks_skipped;
+    counters.cache_hits = std::max(counters.cache_hits, walk.cache_hits);
+
+    const auto materialize_start = StatsClock::now();
+    const size_t rows = std::min<size_t>(matches.size(), limit);
+    const uint64_t allocations_before = out.allocations();
+    out.begin(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        const uint32_t ordinal = matches[i];
+        out.append(ordinal, segment->sfis.get(ordinal), segment->sku_data[ordinal].id);
+    }
+    out.finish();
+    counters.allocations += out.allocations() - allocations_before;
+    if (matches.size() > limit) {
+        PageCursor next;
+        next.query_sfi = query_sfi;
+        next.layout_version = segment->layout_version;
+        next.version = segment->version;
+        next.position = catalog_position(*segment, matches[limit]);
+        next.total = total;
+        page.next_cursor = format_page_cursor(next);
+    }
+    const auto materialize_end = StatsClock::now();
+
+    page.total = total;
+    page.rows = static_cast<uint32_t>(rows);
+    counters.allocations += scratch.growth();
+    record_query(counters, rows, elapsed_ms(scan_start, materialize_start), elapsed_ms(materialize_start, materialize_end));
+    return page;
+}
+
+QueryPage PrimeKit::query_page_primes(const uint32_t* primes, size_t count, const std::string& cursor, uint32_t limit,
+                                      ResultBuffer& out) {
+    uint64_t query_sfi = 1;
+    if (!query_sfi_for_primes(primes, count, query_sfi)) { // Nothing can match
+        out.begin(0);
+        out.finish();
+        return QueryPage();
+    }
+    return query_page(query_sfi, cursor, limit, out);
+}
+
+PrimeKit::ScanCounters PrimeKit::count_matches(const Segment& segment, const CompiledQuery& query, const QueryPlan& plan,
+                                               uint32_t& total, QueryScratch& scratch) {
+    ScanCounters counters;
+    total = 0;
+    if (plan.path == AccessPath::Empty) return counters;
+    if (plan.path == AccessPath::All) {
+        total = static_cast<uint32_t>(segment.sfis.size() - segment.tombstone_count);
+        return counters;
+    }
+    if (auto cached = result_cache_.find(segment.version, query.sfi)) {
+        total = static_cast<uint32_t>(cached->size());
+        counters.cache_hits = 1;
+        return counters;
+    }
+    if (plan.path == AccessPath::Postings) {
+        const std::vector<uint32_t>& list = segment.postings.list(posting_driver(segment, query));
+        segment.column(query.scope).visit([&](const auto& column) {
+            for (uint32_t ordinal : list) {
+                const uint64_t sfi = column[ordinal];
+                total += sfi != 0 && query.divisor.divides(sfi);
+            }
+        });
+        counters.sfis_tested = list.size();
+        return counters;
+    }
+    counters = scan_batch(segment, &query, 1, nullptr, scratch.counts, plan.path == AccessPath::Dictionary, scratch);
+    total = scratch.counts[0];
+    return counters;
+}
+
+PrimeKit::ScanCounters PrimeKit::collect_page(const Segment& segment, const CompiledQuery& query, const QueryPlan& plan,
+                                              uint64_t position, size_t limit, std::vector<uint32_t>& matches) {
+    ScanCounters counters;
+    if (plan.path == AccessPath::Empty || limit == 0) return counters;
+    if (plan.path != AccessPath::All) {
+        if (auto cached = result_cache_.find(segment.version, query.sfi)) {
+            // Cached results are in catalog order already
+            const auto first = std::partition_point(cached->begin(), cached->end(), [&](uint32_t ordinal) {
+                return catalog_position(segment, ordinal) < position;
+            });
+            const size_t take = std::min<size_t>(limit, static_cast<size_t>(cached->end() - first));
+            matches.insert(matches.end(), first, first + take);
+            counters.cache_hits = 1;
+            return counters;
+        }
+    }
+
+    const bool all = plan.path == AccessPath::All;
+    const size_t row_count = segment.sfis.size();
+    segment.column(query.scope).visit([&](const auto& column) {
+        auto matches_row = [&](uint32_t ordinal) {
+            const uint64_t sfi = column[ordinal];
+            return sfi != 0 && (all || query.divisor.divides(sfi));
+        };
+
+        // Clustered rows: catalog order is position order, scattered over storage
+        if (!segment.load_position.empty()) {
+            const auto& ordinal_at_position = segment.ordinal_at_position;
+            size_t next = static_cast<size_t>(std::min<uint64_t>(position, ordinal_at_position.size()));
+            for (; next < ordinal_at_position.size() && matches.size() < limit; ++next) {
+                if (matches_row(ordinal_at_position[next])) matches.push_back(ordinal_at_position[next]);
+                ++counters.sfis_tested;
+            }
+            return;
+        }
+
+        // Otherwise position is the ordinal, and posting lists are in catalog order too
+        if (plan.path == AccessPath::Postings) {
+            const std::vector<uint32_t>& list = segment.postings.list(posting_driver(segment, query));
+            auto it = std::lower_bound(list.begin(), list.end(), position,
+                                       [](uint32_t ordinal, uint64_t value) { return ordinal < value; });
+            for (; it != list.end() && matches.size() < limit; ++it) {
+                if (matches_row(*it)) matches.push_back(*it);
+                ++counters.sfis_tested;
+            }
+            return;
+        }
+
+        // Row scan from the position, one zone map block at a time
+        const ZoneMap& zone_map = segment.zone_map;
+        for (size_t begin = static_cast<size_t>(std::min<uint64_t>(position, row_count));
+             begin < row_count && matches.size() < limit;) {
+            const size_t block = begin / ZoneMap::kBlockRows;
+            const size_t end = std::min(row_count, (block + 1) * ZoneMap::kBlockRows);
+            if (!all && !query.value_mask.empty() &&
+                (block >= zone_map.block_count() || !zone_map.may_contain(block, query.value_mask))) {
+                ++counters.blocks_skipped;
+            } else if (all) {
+                for (size_t row = begin; row < end && matches.size() < limit; ++row) {
+                    if (column[row] != 0) matches.push_back(static_cast<uint32_t>(row));
+                }
+                counters.sfis_tested += end - begin;
+            } else {
+                scan_divisible(column, begin, end, query.divisor, matches);
+                counters.sfis_tested += end - begin;
+            }
+            begin = end;
+        }
+        if (matches.size() > limit) matches.resize(limit);
+    });
+    return counters;
+}
+
+// --- Similar Items ---
+
+std::vector<SimilarItem> PrimeKit::similar(const std::string& sku_id, uint32_t k) {
+    std::vector<SimilarItem> results;
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    const auto it = segment->id_index.find(sku_id);
+    if (it == segment->id_index.end()) {
+        PK_LOG_WARN("similar: unknown SKU id '%s'.", sku_id.c_str());
+        return results;
+    }
+    const uint32_t item = it->second;
+    const auto scan_start = StatsClock::now();
+
+    // Shared values = the item's primes that divide the candidate's SFI, so
+    // each candidate costs one multiply-compare per value of the item
+    std::array<FastDivisor, kMaxSimilarValues> divisors;
+    uint32_t value_count = 0;
+    const PrimeFactorTable& prime_table = segment->schema->prime_table;
+    prime_table.factor(segment->sfis.get(item), [&](uint32_t value_id) {
+        if (value_count < kMaxSimilarValues) divisors[value_count++] = FastDivisor::make(prime_table.entries()[value_id].prime);
+    });
+    if (value_count == 0 || k == 0) return results;
+    auto shared = [&](uint64_t sfi) { return count_dividing(sfi, divisors.data(), value_count); };
+
+    ScratchLease scratch(*this);
+    ScanCounters counters;
+    const SfiDictionary& dictionary = segment->dictionary;
+    const size_t rows = segment->sfis.size();
+    const bool use_dictionary = dictionary.code_count() * kDictionaryScanRatio <= rows;
+
+    // Pass 1: how many rows share each number of values. With the dictionary
+    // every distinct SFI is scored once for its whole group; otherwise every
+    // row is, and its count kept for pass 2.
+    std::array<uint64_t, kMaxSimilarValues + 1> histogram{};
+    std::vector<uint32_t>& code_shared = scratch->counts;
+    if (use_dictionary) {
+        code_shared.resize(dictionary.code_count());
+        for (uint32_t code = 0; code < dictionary.code_count(); ++code) {
+            code_shared[code] = shared(dictionary.sfi(code));
+            histogram[code_shared[code]] += dictionary.ordinals(code).size();
+        }
+        counters.sfis_tested = dictionary.code_count();
+    } else {
+        scratch->levels.resize(rows);
+        segment->sfis.visit([&](const auto& column) {
+            count_dividing_rows(column, divisors.data(), value_count, scratch->levels.data(), histogram.data());
+        });
+        counters.sfis_tested = rows;
+    }
+    --histogram[value_count]; // The item itself
+
+    // The k best are every row sharing more than `threshold` values (`above`
+    // of them) plus the first `ties` rows, in catalog order, sharing exactly that
+    uint32_t threshold = 1;
+    uint64_t above = 0;
+    for (uint32_t level = value_count; level >= 1; --level) {
+        if (above + histogram[level] >= k || level == 1) {
+            threshold = level;
+            break;
+        }
+        above += histogram[level];
+    }
+    const uint64_t ties = std::min<uint64_t>(k - above, histogram[threshold]);
+
+    // Pass 2: collect them
+    auto ordinal_at = [&](size_t position) {
+        return segment->ordinal_at_position.empty() ? static_cast<uint32_t>(position) : segment->ordinal_at_position[position];
+    };
+    std::vector<uint32_t>& picked = scratch->matches;
+    picked.clear();
+    if (use_dictionary) {
+        // Tie groups are unordered: gather them and keep the earliest, unless
+        // walking the catalog to the first `ties` of them is cheaper
+        const uint64_t tie_rows = histogram[threshold];
+        const bool gather_ties = tie_rows * tie_rows <= ties * rows;
+        std::vector<uint32_t>& tied = scratch->pending;
+        tied.clear();
+        for (uint32_t code = 0; code < dictionary.code_count(); ++code) {
+            const bool tie = code_shared[code] == threshold;
+            if (code_shared[code] < threshold || (tie && !gather_ties)) continue;
+            for (uint32_t ordinal : dictionary.ordinals(code)) {
+                if (ordinal != item) (tie ? tied : picked).push_back(ordinal);
+            }
+        }
+        if (gather_ties) {
+            auto by_position = [&](uint32_t a, uint32_t b) {
+                return catalog_position(*segment, a) < catalog_position(*segment, b);
+            };
+            if (tied.size() > ties) {
+                std::nth_element(tied.begin(), tied.begin() + ties, tied.end(), by_position);
+                tied.resize(ties);
+            }
+            picked.insert(picked.end(), tied.begin(), tied.end());
+        } else {
+            for (size_t position = 0, taken = 0; position < rows && taken < ties; ++position) {
+                const uint32_t ordinal = ordinal_at(position);
+                const uint32_t code = dictionary.code_of(ordinal);
+                if (ordinal == item || code == SfiDictionary::kNoCode || code_shared[code] != threshold) continue;
+                picked.push_back(ordinal);
+                ++taken;
+            }
+        }
+    } else {
+        // One walk in catalog order, stopping once every pick is found
+        const std::vector<uint8_t>& levels = scratch->levels;
+        uint64_t above_left = above, ties_left = ties;
+        for (size_t position = 0; position < rows && (above_left || ties_left); ++position) {
+            const uint32_t ordinal = ordinal_at(position);
+            if (ordinal == item || levels[ordinal] < threshold) continue;
+            if (levels[ordinal] > threshold) {
+                picked.push_back(ordinal);
+                --above_left;
+            } else if (ties_left) {
+                picked.push_back(ordinal);
+                --ties_left;
+            }
+        }
+    }
+
+    const auto materialize_start = StatsClock::now();
+    results.reserve(picked.size());
+    for (uint32_t ordinal : picked) {
+        const uint64_t sfi = segment->sfis.get(ordinal);
+        results.push_back({std::string(segment->sku_data[ordinal].id), sfi, ordinal, shared(sfi)});
+    }
+    std::sort(results.begin(), results.end(), [&](const SimilarItem& a, const SimilarItem& b) {
+        if (a.shared != b.shared) return a.shared > b.shared;
+        return catalog_position(*segment, a.ordinal) < catalog_position(*segment, b.ordinal);
+    });
+    const auto materialize_end = StatsClock::now();
+
+    counters.allocations += scratch.growth();
+    record_query(counters, results.size(), elapsed_ms(scan_start, materialize_start),
+                 elapsed_ms(materialize_start, materialize_end));
+    return results;
+}
+
+// --- Soft Matching ---
+
+void PrimeKit::set_attribute_weight(const std::string& attribute, double weight) {
+    if (!std::isfinite(weight) || weight < 0) {
+        throw std::runtime_error("Attribute weight must be a finite, non-negative number.");
+    }
+    std::lock_guard<std::mutex> lock(weights_mutex_);
+    attribute_weights_[attribute] = weight;
+}
+
+void PrimeKit::add_soft_value(const Segment& segment, SoftQuery& query, uint64_t divisor, uint32_t value_id) const {
+    for (uint32_t j = 0; j < query.count; ++j) {
+        if (query.divisors[j].divisor == divisor) return; // Repeats count once
+    }
+    if (query.count == kMaxSoftValues) {
+        throw std::runtime_error("Soft match queries take at most " + std::to_string(kMaxSoftValues) + " values.");
+    }
+    double weight = 1;
+    if (value_id != SoftQuery::kNoValue) {
+        const PrimeFactorTable& prime_table = segment.schema->prime_table;
+        const std::string& attribute = prime_table.attributes()[prime_table.entries()[value_id].attribute_index];
+        std::lock_guard<std::mutex> lock(weights_mutex_);
+        auto it = attribute_weights_.find(attribute);
+        if (it != attribute_weights_.end()) weight = it->second;
+    }
+    query.divisors[query.count] = FastDivisor::make(divisor);
+    query.value_ids[query.count] = value_id;
+    query.weights[query.count] = weight;
+    ++query.count;
+}
+
+std::vector<SoftMatch> PrimeKit::soft_filter(uint64_t query_sfi, uint32_t min_matched, uint32_t limit) {
+    if (query_sfi == 0) {
+        PK_LOG_ERROR("Query SFI cannot be zero.");
+        return {};
+    }
+    auto segment = current_segment();
+    const PrimeFactorTable& prime_table = segment->schema->prime_table;
+    SoftQuery query;
+    const uint64_t remainder = prime_table.factor(query_sfi, [&](uint32_t value_id) {
+        add_soft_value(*segment, query, prime_table.entries()[value_id].prime, value_id);
+    });
+    if (remainder > 1) add_soft_value(*segment, query, remainder, SoftQuery::kNoValue); // One unknown value
+    return run_soft_filter(segment, query, min_matched, limit);
+}
+
+std::vector<SoftMatch> PrimeKit::soft_filter_primes(const uint32_t* primes, size_t count, uint32_t min_matched,
+                                                    uint32_t limit) {
+    auto segment = current_segment();
+    const PrimeFactorTable& prime_table = segment->schema->prime_table;
+    SoftQuery query;
+    for (size_t i = 0; i < count; ++i) {
+        if (primes[i] <= 1) continue; // "Any" selections
+        uint32_t value_id = SoftQuery::kNoValue;
+        const uint64_t remainder = prime_table.factor(primes[i], [&](uint32_t id) { value_id = id; });
+        add_soft_value(*segment, query, primes[i], remainder == 1 ? value_id : SoftQuery::kNoValue);
+    }
+    return run_soft_filter(segment, query, min_matched, limit);
+}
+
+std::vector<SoftMatch> PrimeKit::run_soft_filter(const std::shared_ptr<Segment>& pinned, const SoftQuery& query,
+                                                 uint32_t min_matched, uint32_t limit) {
+    std::vector<SoftMatch> results;
+    min_matched = std::max<uint32_t>(min_matched, 1);
+    if (limit == 0 || query.count < min_matched) return results;
+
+    const Segment& segment = *pinned;
+    std::shared_lock<std::shared_mutex> lock(segment.mutex);
+    const auto scan_start = StatsClock::now();
+    ScratchLease scratch(*this);
+    ScanCounters counters;
+
+    // A row's matched values as bits (one FastDivisor test per value); its
+    // score sums their weights in a fixed order, so equal sets score equal
+    const FastDivisor* divisors = query.divisors.data();
+    const uint32_t value_count = query.count;
+    auto score_of = [&](uint32_t bits) {
+        double score = 0;
+        for (; bits; bits &= bits - 1) score += query.weights[__builtin_ctz(bits)];
+        return score;
+    };
+
+    // Top-K heap with the worst kept row at the front
+    std::vector<RankedRow>& ranked = scratch->ranked;
+    ranked.clear();
+    auto better = [](const RankedRow& a, const RankedRow& b) {
+        return a.score != b.score ? a.score > b.score : a.position < b.position;
+    };
+    auto full = [&] { return ranked.size() == limit; };
+    auto offer = [&](uint32_t ordinal, uint32_t matched, double score) {
+        if (full() && score < ranked.front().score) return;
+        const RankedRow row{score, catalog_position(segment, ordinal), ordinal, matched};
+        if (!full()) {
+            ranked.push_back(row);
+            std::push_heap(ranked.begin(), ranked.end(), better);
+        } else if (better(row, ranked.front())) {
+            std::pop_heap(ranked.begin(), ranked.end(), better);
+            ranked.back() = row;
+            std::push_heap(ranked.begin(), ranked.end(), better);
+        }
+    };
+
+    const SfiDictionary& dictionary = segment.dictionary;
+    const size_t rows = segment.sfis.size();
+    if (dictionary.code_count() * kDictionaryScanRatio <= rows) {
+        // Every row of a group scores the same, so a group scoring below a
+        // full heap is passed over whole
+        for (uint32_t code = 0; code < dictionary.code_count(); ++code) {
+            const uint32_t bits = divisor_bits(dictionary.sfi(code), divisors, value_count);
+            const uint32_t matched = static_cast<uint32_t>(__builtin_popcount(bits));
+            if (matched < min_matched) continue;
+            const double score = score_of(bits);
+            if (full() && score < ranked.front().score) continue;
+            for (uint32_t ordinal : dictionary.ordinals(code)) offer(ordinal, matched, score);
+        }
+        counters.sfis_tested = dictionary.code_count();
+    } else {
+        // One pass over the rows. The zone map bounds what a block's rows can
+        // match and score, so blocks that can't reach min_matched or the heap are skipped.
+        const ZoneMap& zone_map = segment.zone_map;
+        segment.sfis.visit([&](const auto& column) {
+            for (size_t begin = 0; begin < rows; begin += ZoneMap::kBlockRows) {
+                const size_t end = std::min(rows, begin + ZoneMap::kBlockRows);
+                const size_t block = begin / ZoneMap::kBlockRows;
+                if (zone_map.enabled() && block < zone_map.block_count()) {
+                    uint32_t present = 0; // Values the block may carry; unknown ones always may
+                    for (uint32_t j = 0; j < value_count; ++j) {
+                        const uint32_t value_id = query.value_ids[j];
+                        if (value_id == SoftQuery::kNoValue || zone_map.contains(block, value_id)) present |= 1u << j;
+                    }
+                    if (static_cast<uint32_t>(__builtin_popcount(present)) < min_matched ||
+                        (full() && score_of(present) < ranked.front().score)) {
+                        ++counters.blocks_skipped;
+                        continue;
+                    }
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    const uint32_t bits = divisor_bits(column[i], divisors, value_count);
+                    const uint32_t matched = static_cast<uint32_t>(__builtin_popcount(bits));
+                    if (matched >= min_matched) offer(static_cast<uint32_t>(i), matched, score_of(bits));
+                }
+                counters.sfis_tested += end - begin;
+            }
+        });
+    }
+
+    const auto materialize_start = StatsClock::now();
+    std::sort_heap(ranked.begin(), ranked.end(), better); // Best first
+    results.reserve(ranked.size());
+    for (const RankedRow& row : ranked) {
+        results.push_back({std::string(segment.sku_data[row.ordinal].id), segment.sfis.get(row.ordinal), row.ordinal,
+                           row.matched, row.score});
+    }
+    const auto materialize_end = StatsClock::now();
+
+    counters.allocations += scratch.growth();
+    record_query(counters, results.size(), elapsed_ms(scan_start, materialize_start),
+                 elapsed_ms(materialize_start, materialize_end));
+    return results;
+}
+
+std::unique_ptr<QueryCursor> PrimeKit::start_query(uint64_t query_sfi) {
+    if (query_sfi == 0) PK_LOG_ERROR("Query SFI cannot be zero."); // Plans as empty
+    return std::make_unique<QueryCursor>(*this, query_sfi);
+}
+
+std::unique_ptr<QueryCursor> PrimeKit::start_query_primes(const uint32_t* primes, size_t count) {
+    uint64_t query_sfi = 1;
+    if (!query_sfi_for_primes(primes, count, query_sfi)) query_sfi = 0; // Nothing can match
+    return std::make_unique<QueryCursor>(*this, query_sfi);
+}
+
+QueryPlan PrimeKit::explain(uint64_t query_sfi) {
+    QueryPlan plan;
+    if (query_sfi == 0) {
+        PK_LOG_ERROR("Query SFI cannot be zero.");
+        plan.path = AccessPath::Empty;
+        plan.strategy = access_path_name(plan.path);
+        return plan;
+    }
+
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    const auto start = StatsClock::now();
+    ScratchLease scratch(*this);
+    compile_query(*segment, query_sfi, scratch->query);
+    std::vector<uint32_t>& matches = scratch->matches;
+    run_query(*segment, scratch->query, matches, plan, *scratch);
+    plan.elapsed_ms = elapsed_ms(start, StatsClock::now());
+    plan.actual_rows = static_cast<uint32_t>(matches.size());
+    return plan;
+}
+
+void PrimeKit::set_result_cache_bytes(size_t bytes) {
+    result_cache_.set_budget(bytes);
+}
+
+CompiledQuery PrimeKit::compile_query(const Segment& segment, uint64_t query_sfi) {
+    CompiledQuery query;
+    compile_query(segment, query_sfi, query);
+    return query;
+}
+
+void PrimeKit::compile_query(const Segment& segment, uint64_t query_sfi, CompiledQuery& query) {
+    query.sfi = query_sfi;
+    query.divisor = FastDivisor::make(query_sfi);
+    query.value_ids.clear();
+    query.remainder = 1;
+    query.value_mask.clear();
+    query.scope = SfiScope::Full;
+    if (query_sfi <= 1) return;
+
+    query.remainder = segment.schema->prime_table.factor(query_sfi, [&](uint32_t value_id) {
+        query.value_ids.push_back(value_id);
+    });
+    const ZoneMap& zone_map = segment.zone_map;
+    if (query.remainder == 1 && zone_map.enabled()) { // Else: no skipping, scan every block
+        query.value_mask.assign(zone_map.words_per_block(), 0);
+        for (uint32_t value_id : query.value_ids) {
+            query.value_mask[value_id / 64] |= uint64_t(1) << (value_id % 64);
+        }
+    }
+
+    // A query on one side of a split schema can read that side's column:
+    // with coprime primes, the SFI is divisible by master (local) primes
+    // exactly when its master (local) part is
+    const PrimeSchema& schema = *segment.schema;
+    if (schema.split && query.remainder == 1 && schema.prime_table.pairwise_coprime() && !query.value_ids.empty()) {
+        size_t local_count = 0;
+        for (uint32_t value_id : query.value_ids) local_count += schema.local_values[value_id];
+        if (local_count == 0) {
+            query.scope = SfiScope::Master;
+        } else if (local_count == query.value_ids.size()) {
+            query.scope = SfiScope::Local;
+        }
+    }
+}
+
+// --- Query Planning ---
+
+QueryPlan PrimeKit::plan_query(const Segment& segment, const CompiledQuery& query) {
+    QueryPlan plan;
+    const double row_count = static_cast<double>(segment.sfis.size());
+    const double live_count = row_count - static_cast<double>(segment.tombstone_count);
+    auto choose = [&](AccessPath path, double cost) {
+        plan.path = path;
+        plan.strategy = access_path_name(path);
+        plan.estimated_cost = cost;
+        return plan;
+    };
+    plan.column = sfi_scope_name(query.scope);
+
+    if (query.sfi == 1) {
+        plan.estimated_rows = live_count;
+        return choose(AccessPath::All, row_count);
+    }
+    if (query.sfi == 0 || query.sfi > segment.column(query.scope).max_value() || live_count == 0) {
+        return choose(AccessPath::Empty, 0);
+    }
+
+    // Selectivity: the product of each required value's live-row frequency,
+    // as if attributes were independent. Without statistics (schemas whose
+    // primes are not coprime) assume the worst, every live row.
+    const PostingIndex& postings = segment.postings;
+    const bool have_stats = postings.enabled() && !query.value_ids.empty();
+    double estimated_rows = live_count;
+    size_t shortest_list = SIZE_MAX;
+    if (have_stats) {
+        // Another reader may be sorting (and de-duplicating) one of these lists
+        std::lock_guard<std::mutex> sort_lock(segment.postings_mutex);
+        for (uint32_t value_id : query.value_ids) {
+            const uint32_t cardinality = postings.cardinality(value_id);
+            if (cardinality == 0) return choose(AccessPath::Empty, 0); // No live row carries this value
+            estimated_rows *= cardinality / live_count;
+            shortest_list = std::min(shortest_list, postings.list_size(value_id));
+        }
+    }
+    plan.estimated_rows = estimated_rows;
+
+    // Gathering matches costs the same on every path; putting them in catalog
+    // order costs a sort (or bitmap sweep) unless the path yields them in order
+    const bool clustered = !segment.load_position.empty();
+    const double gather_cost = estimated_rows * kGatherCost;
+    const double order_cost = estimated_rows * 16 < row_count
+                                  ? estimated_rows * std::log2(estimated_rows + 2) * kSortCost
+                                  : row_count / 64 + estimated_rows * 2;
+
+    plan.scan_cost = row_count + gather_cost + (clustered ? order_cost : 0);
+    plan.dictionary_cost = segment.dictionary.code_count() * kDictionaryCodeCost + gather_cost + order_cost;
+    if (have_stats) {
+        plan.postings_cost = shortest_list * kPostingCost + gather_cost + (clustered ? order_cost : 0);
+    }
+
+    if (plan.postings_cost > 0 && plan.postings_cost <= plan.scan_cost && plan.postings_cost <= plan.dictionary_cost) {
+        return choose(AccessPath::Postings, plan.postings_cost);
+    }
+    if (plan.dictionary_cost < plan.scan_cost) return choose(AccessPath::Dictionary, plan.dictionary_cost);
+    return choose(AccessPath::Scan, plan.scan_cost);
+}
+
+PrimeKit::ScanCounters PrimeKit::run_query(const Segment& segment, const CompiledQuery& query,
+                                           std::vector<uint32_t>& matches, QueryPlan& plan, QueryScratch& scratch) {
+    plan = plan_query(segment, query);
+    const bool cacheable = plan.path != AccessPath::All && plan.path != AccessPath::Empty;
+    if (cacheable) {
+        if (auto cached = result_cache_.find(segment.version, query.sfi)) {
+            matches.assign(cached->begin(), cached->end());
+            plan.path = AccessPath::Cache;
+            plan.strategy = access_path_name(plan.path);
+            plan.estimated_cost = static_cast<double>(matches.size()) * kGatherCost;
+            ScanCounters counters;
+            counters.cache_hits = 1;
+            return counters;
+        }
+    }
+
+    ScanCounters counters = scan_matches(segment, query, plan.path, matches, scratch);
+    if (cacheable && result_cache_.admits(matches.size())) {
+        result_cache_.insert(segment.version, query.sfi, std::make_shared<const std::vector<uint32_t>>(matches));
+        ++counters.allocations;
+    }
+    return counters;
+}
+
+PrimeKit::ScanCounters PrimeKit::scan_matches(const Segment& segment, const CompiledQuery& query, AccessPath path,
+                                              std::vector<uint32_t>& matches, QueryScratch& scratch) {
+    matches.clear();
+    if (path == AccessPath::Empty) return ScanCounters();
+    if (path == AccessPath::Postings) return scan_postings(segment, query, matches, scratch);
+
+    const ScanCounters counters = scan_batch(segment, &query, 1, &scratch.ordinals, scratch.counts,
+                                             path == AccessPath::Dictionary, scratch);
+    matches.swap(scratch.ordinals[0]); // Both buffers keep their capacity
+    return counters;
+}
+
+uint32_t PrimeKit::posting_driver(const Segment& segment, const CompiledQuery& query) {
+    const PostingIndex& postings = segment.postings;
+    // Sizes are read under the lock too: another reader may be sorting a list.
+    // Once sorted, a list stays sorted until the next update, which needs
+    // the exclusive lock; so reading it after this is safe
+    std::lock_guard<std::mutex> sort_lock(segment.postings_mutex);
+    uint32_t driver = query.value_ids[0];
+    for (uint32_t value_id : query.value_ids) {
+        if (postings.list_size(value_id) < postings.list_size(driver)) driver = value_id;
+    }
+    segment.postings.sort(driver);
+    return driver;
+}
+
+PrimeKit::ScanCounters PrimeKit::scan_postings(const Segment& segment, const CompiledQuery& query,
+                                               std::vector<uint32_t>& matches, QueryScratch& scratch) {
+    const uint32_t driver = posting_driver(segment, query);
+
+    // Lists hold stale entries (re-encoded or removed rows), so every row is re-tested
+    const std::vector<uint32_t>& list = segment.postings.list(driver);
+    segment.column(query.scope).visit([&](const auto& column) {
+        for (uint32_t ordinal : list) {
+            const uint64_t sfi = column[ordinal];
+            if (sfi != 0 && query.divisor.divides(sfi)) matches.push_back(ordinal);
+        }
+    });
+    if (!segment.load_position.empty()) to_catalog_order(segment, matches, scratch.bitmap);
+
+    ScanCounters counters;
+    counters.sfis_tested = list.size();
+    return counters;
+}
+
+PrimeKit::ScanCounters PrimeKit::scan_batch(const Segment& segment, const CompiledQuery* queries, size_t query_count,
+                                            std::vector<std::vector<uint32_t>>* ordinals, std::vector<uint32_t>& counts,
+                                            bool use_dictionary, QueryScratch& scratch) {
+    const SfiColumn& sfis = segment.sfis;
+    const SfiDictionary& dictionary = segment.dictionary;
+    const size_t row_count = sfis.size();
+    ScanCounters counters;
+    counts.assign(query_count, 0);
+    if (ordinals) {
+        if (ordinals->size() < query_count) ordinals->resize(query_count);
+        for (size_t q = 0; q < query_count; ++q) (*ordinals)[q].clear(); // Lists keep their capacity
+    }
+
+    // Match-all queries are answered directly; zero and queries wider than
+    // the column can't match anything. The rest share one pass.
+    std::vector<uint32_t>& pending = scratch.pending;
+    pending.clear();
+    for (uint32_t q = 0; q < query_count; ++q) {
+        const uint64_t query_sfi = queries[q].sfi;
+        if (query_sfi == 1) { // Optimization: If query is 1, all items match
+            counts[q] = static_cast<uint32_t>(row_count - segment.tombstone_count);
+            if (!ordinals) continue;
+            auto& matches = (*ordinals)[q];
+            matches.reserve(counts[q]);
+            const auto& ordinal_at_position = segment.ordinal_at_position;
+            for (uint32_t i = 0; i < row_count; ++i) {
+                const uint32_t ordinal = ordinal_at_position.empty() ? i : ordinal_at_position[i];
+                if (sfis.get(ordinal) != 0) matches.push_back(ordinal); // Skip tombstones
+            }
+        } else if (query_sfi != 0 && query_sfi <= sfis.max_value()) {
+            pending.push_back(q);
+        }
+    }
+    if (pending.empty()) return counters;
+
+    if (use_dictionary) {
+        // Few distinct SFIs: test each once per query and expand only the matching groups
+        counters.sfis_tested = dictionary.code_count();
+        for (uint32_t code = 0; code < dictionary.code_count(); ++code) {
+            const auto& group = dictionary.ordinals(code);
+            if (group.empty()) continue;
+            const uint64_t sfi = dictionary.sfi(code);
+            for (uint32_t q : pending) {
+                if (!queries[q].divisor.divides(sfi)) continue;
+                counts[q] += static_cast<uint32_t>(group.size());
+                if (ordinals) (*ordinals)[q].insert((*ordinals)[q].end(), group.begin(), group.end());
+            }
+        }
+        // Groups interleave in the catalog and are unordered after updates
+        if (ordinals) {
+            for (uint32_t q : pending) to_catalog_order(segment, (*ordinals)[q], scratch.bitmap);
+        }
+        return counters;
+    }
+
+    // Row scan at the column's width, one block at a time: the block's SFIs
+    // are pulled from memory once and stay in cache while every query whose
+    // zone map mask allows it runs the kernel over them. When every query
+    // reads the same side of a split schema, that narrower column is scanned.
+    SfiScope scope = queries[pending[0]].scope;
+    for (uint32_t q : pending) {
+        if (queries[q].scope != scope) scope = SfiScope::Full;
+    }
+    const ZoneMap& zone_map = segment.zone_map;
+    segment.column(scope).visit([&](const auto& column) {
+        for (size_t begin = 0; begin < row_count; begin += ZoneMap::kBlockRows) {
+            const size_t end = std::min(row_count, begin + ZoneMap::kBlockRows);
+            const size_t block = begin / ZoneMap::kBlockRows;
+            bool tested = false;
+            for (uint32_t q : pending) {
+                const CompiledQuery& query = queries[q];
+                // Blocks past the map's end have no rows with values, so they can't match
+                if (!query.value_mask.empty() &&
+                    (block >= zone_map.block_count() || !zone_map.may_contain(block, query.value_mask))) {
+                    continue;
+                }
+                tested = true;
+                if (ordinals) {
+                    auto& matches = (*ordinals)[q];
+                    const size_t before = matches.size();
+                    scan_divisible(column, begin, end, query.divisor, matches);
+                    counts[q] += static_cast<uint32_t>(matches.size() - before);
+                } else {
+                    counts[q] += static_cast<uint32_t>(count_divisible(column, begin, end, query.divisor));
+                }
+            }
+            if (tested) {
+                counters.sfis_tested += end - begin;
+            } else {
+                ++counters.blocks_skipped;
+            }
+        }
+    });
+    // Storage order is catalog order unless the load clustered the rows
+    if (ordinals && !segment.load_position.empty()) {
+        for (uint32_t q : pending) to_catalog_order(segment, (*ordinals)[q], scratch.bitmap);
+    }
+    return counters;
+}
+
+void PrimeKit::to_catalog_order(const Segment& segment, std::vector<uint32_t>& ordinals, std::vector<uint64_t>& bitmap) {
+    const auto& load_position = segment.load_position;
+    const size_t row_count = segment.sku_data.size();
+    if (load_position.empty()) {
+        // Catalog order is ordinal order: sort small results, sweep a row bitmap for large ones
+        if (ordinals.size() * 16 < row_count) {
+            std::sort(ordinals.begin(), ordinals.end());
+            return;
+        }
+        bitmap.assign((row_count + 63) / 64, 0);
+        for (uint32_t ordinal : ordinals) bitmap[ordinal >> 6] |= uint64_t(1) << (ordinal & 63);
+        ordinals.clear();
+        for (uint32_t word = 0; word < bitmap.size(); ++word) {
+            for (uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+                ordinals.push_back((word << 6) + static_cast<uint32_t>(__builtin_ctzll(bits)));
+            }
+        }
+        return;
+    }
+
+    // Clustered segment: order by load position instead
+    if (ordinals.size() * 16 < row_count) {
+        std::sort(ordinals.begin(), ordinals.end(),
+                  [&](uint32_t a, uint32_t b) { return load_position[a] < load_position[b]; });
+        return;
+    }
+    bitmap.assign((row_count + 63) / 64, 0);
+    for (uint32_t ordinal : ordinals) {
+        const uint32_t position = load_position[ordinal];
+        bitmap[position >> 6] |= uint64_t(1) << (position & 63);
+    }
+    ordinals.clear();
+    for (uint32_t word = 0; word < bitmap.size(); ++word) {
+        for (uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+            ordinals.push_back(segment.ordinal_at_position[(word << 6) + static_cast<uint32_t>(__builtin_ctzll(bits))]);
+        }
+    }
+}
+
+void PrimeKit::set_cluster_on_load(bool enabled) {
+    cluster_on_load_.store(enabled);
+}
+
+void PrimeKit::cluster_rows(Segment& segment) {
+    const PrimeFactorTable& prime_table = segment.schema->prime_table;
+    const size_t row_count = segment.sku_data.size();
+    if (prime_table.empty() || row_count < 2) return;
+    const auto& entries = prime_table.entries();
+    const size_t attribute_count = prime_table.attributes().size();
+
+    // Attributes with the fewest values sort outermost: they get the longest
+    // runs, and the attributes inside them still get runs of useful length.
+    std::vector<uint32_t> value_counts(attribute_count, 0);
+    for (const PrimeEntry& entry : entries) ++value_counts[entry.attribute_index];
+    std::vector<uint32_t> attribute_order(attribute_count);
+    std::iota(attribute_order.begin(), attribute_order.end(), 0);
+    std::stable_sort(attribute_order.begin(), attribute_order.end(),
+                     [&](uint32_t a, uint32_t b) { return value_counts[a] < value_counts[b]; });
+    std::vector<uint32_t> key_slot(attribute_count);
+    for (uint32_t k = 0; k < attribute_count; ++k) key_slot[attribute_order[k]] = k;
+
+    // Sort key per distinct SFI: for each attribute (outermost first), 1 + the
+    // lowest value id present, or 0 when the SKU has no value for it
+    std::unordered_map<uint64_t, uint32_t> code_of;
+    std::vector<uint64_t> distinct_sfis;
+    std::vector<uint32_t> row_codes(row_count);
+    for (uint32_t i = 0; i < row_count; ++i) {
+        const uint64_t sfi = segment.sfis.get(i);
+        auto [it, inserted] = code_of.try_emplace(sfi, static_cast<uint32_t>(distinct_sfis.size()));
+        if (inserted) distinct_sfis.push_back(sfi);
+        row_codes[i] = it->second;
+    }
+    const size_t code_count = distinct_sfis.size();
+    std::vector<uint32_t> keys(code_count * attribute_count, 0);
+    for (uint32_t code = 0; code < code_count; ++code) {
+        uint32_t* key = keys.data() + code * attribute_count;
+        prime_table.factor(distinct_sfis[code], [&](uint32_t value_id) { // Ascending value ids
+            uint32_t& slot = key[key_slot[entries[value_id].attribute_index]];
+            if (slot == 0) slot = value_id + 1;
+        });
+    }
+    std::vector<uint32_t> code_order(code_count);
+    std::iota(code_order.begin(), code_order.end(), 0);
+    std::sort(code_order.begin(), code_order.end(), [&](uint32_t a, uint32_t b) {
+        const uint32_t* ka = keys.data() + a * attribute_count;
+        const uint32_t* kb = keys.data() + b * attribute_count;
+        return std::lexicographical_compare(ka, ka + attribute_count, kb, kb + attribute_count);
+    });
+
+    // Stable counting sort of rows by their code's rank: equal SFIs keep JSON order
+    std::vector<uint32_t> next(code_count + 1, 0);
+    std::vector<uint32_t> rank(code_count);
+    for (uint32_t r = 0; r < code_count; ++r) rank[code_order[r]] = r;
+    for (uint32_t i = 0; i < row_count; ++i) ++next[rank[row_codes[i]] + 1];
+    std::partial_sum(next.begin(), next.end(), next.begin());
+
+    std::vector<uint32_t> ordinal_at_position(row_count);
+    for (uint32_t i = 0; i < row_count; ++i) ordinal_at_position[i] = next[rank[row_codes[i]]]++;
+
+    std::vector<SkuData> sku_data(row_count);
+    std::vector<EncodedSfi> sfis(row_count);
+    const bool split = segment.schema->split;
+    segment.load_position.assign(row_count, 0);
+    for (uint32_t position = 0; position < row_count; ++position) {
+        const uint32_t ordinal = ordinal_at_position[position];
+        sku_data[ordinal] = std::move(segment.sku_data[position]);
+        sfis[ordinal].sfi = distinct_sfis[row_codes[position]];
+        if (split) {
+            sfis[ordinal].master = segment.master_sfis.get(position);
+            sfis[ordinal].local = segment.local_sfis.get(position);
+        }
+        segment.load_position[ordinal] = position;
+    }
+    segment.sku_data = std::move(sku_data);
+    for (SfiColumn* column : {&segment.sfis, &segment.master_sfis, &segment.local_sfis}) column->clear();
+    segment.sfis.reserve(row_count);
+    for (uint32_t ordinal = 0; ordinal < row_count; ++ordinal) segment.store_sfi(ordinal, sfis[ordinal]);
+    segment.ordinal_at_position = std::move(ordinal_at_position);
+}
+
+void PrimeKit::index_row(Segment& segment, uint32_t ordinal, uint64_t old_sfi, uint64_t new_sfi) {
+    // Zone maps and postings are built together, for coprime schemas only
+    if (!segment.postings.enabled() || old_sfi == new_sfi) return;
+    const PrimeFactorTable& prime_table = segment.schema->prime_table;
+    if (old_sfi > 1) {
+        prime_table.factor(old_sfi, [&](uint32_t value_id) { segment.postings.release(value_id); });
+    }
+    if (new_sfi > 1) {
+        prime_table.factor(new_sfi, [&](uint32_t value_id) {
+            segment.zone_map.mark(ordinal, value_id);
+            segment.postings.add(value_id, ordinal);
+        });
+    }
+}
+
+void PrimeKit::record_query(const ScanCounters& counters, uint64_t matches, double scan_ms, double materialize_ms,
+                            uint64_t query_count) {
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    stats_.last_scan_ms = scan_ms;
+    stats_.last_materialize_ms = materialize_ms;
+    stats_.last_skus_scanned = counters.sfis_tested;
+    stats_.last_blocks_skipped = counters.blocks_skipped;
+    stats_.last_matches = matches;
+    stats_.last_allocations = counters.allocations;
+    stats_.queries += query_count;
+    stats_.total_skus_scanned += counters.sfis_tested;
+    stats_.total_blocks_skipped += counters.blocks_skipped;
+    stats_.cache_hits += counters.cache_hits;
+    stats_.total_allocations += counters.allocations;
+    stats_.total_matches += matches;
+    stats_.total_scan_ms += scan_ms;
+    stats_.total_materialize_ms += materialize_ms;
+}
+
+EngineStats PrimeKit::get_stats() const {
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    return stats_;
+}
+
+void PrimeKit::reset_stats() {
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    stats_ = EngineStats();
+}
+
+// --- Incremental Updates ---
+
+// Reads an {"attr": ["v1", ...], ...} object; non-array values and non-string entries are ignored
+static ItemAttributes attributes_from_json(const json& attributes_json) {
+    ItemAttributes attributes;
+    if (!attributes_json.is_object()) return attributes;
+    for (auto const& [attr_key, attr_values] : attributes_json.items()) {
+        if (!attr_values.is_array()) continue;
+        auto& values = attributes[attr_key];
+        for (const auto& val : attr_values) {
+            if (val.is_string()) values.push_back(val.get<std::string>());
+        }
+    }
+    return attributes;
+}
+
+void PrimeKit::rebuild_indexes(Segment& segment) {
+    segment.id_index.clear();
+    segment.id_index.reserve(segment.sku_data.size());
+    segment.dictionary.clear();
+    segment.dictionary.reserve(segment.sku_data.size());
+    for (uint32_t i = 0; i < segment.sku_data.size(); ++i) {
+        const uint64_t sfi = segment.sfis.get(i);
+        if (sfi != 0) {
+            segment.id_index[segment.sku_data[i].id] = i; // Duplicate ids: the last row wins
+        }
+        segment.dictionary.assign(i, sfi);
+    }
+
+    // Zone maps and postings: factor each distinct SFI once, then OR its
+    // values into the row's block and append the row to their lists
+    const PrimeFactorTable& prime_table = segment.schema->prime_table;
+    if (!prime_table.pairwise_coprime() || prime_table.empty()) {
+        segment.zone_map.clear();
+        segment.postings.clear();
+        return;
+    }
+    const uint32_t value_count = static_cast<uint32_t>(prime_table.entries().size());
+    segment.zone_map.reset(value_count);
+    segment.postings.reset(value_count);
+    std::vector<std::vector<uint32_t>> code_values(segment.dictionary.code_count());
+    for (uint32_t code = 0; code < code_values.size(); ++code) {
+        prime_table.factor(segment.dictionary.sfi(code), [&](uint32_t value_id) { code_values[code].push_back(value_id); });
+    }
+    for (uint32_t i = 0; i < segment.sku_data.size(); ++i) {
+        const uint32_t code = segment.dictionary.code_of(i);
+        if (code == SfiDictionary::kNoCode) continue;
+        for (uint32_t value_id : code_values[code]) {
+            segment.zone_map.mark(i, value_id);
+            segment.postings.add(value_id, i);
+        }
+    }
+}
+
+EncodedSfi PrimeKit::encode_sku(const Segment& segment, const std::string& id, const ItemAttributes& attributes) {
+    // Same encoder as initializeFromJson
+    const PrimeSchema& schema = *segment.schema;
+    EncodedSfi encoded;
+    const bool fits = schema.with_lookup([&](const auto& primes) {
+        return encode_attributes(schema, primes, attributes, encoded);
+    });
+    if (!fits) {
+        throw std::runtime_error("SFI overflow while encoding SKU " + id + ".");
+    }
+    return encoded;
+}
+
+uint32_t PrimeKit::upsert_locked(Segment& segment, const std::string& id, const ItemAttributes& attributes) {
+    const EncodedSfi encoded = encode_sku(segment, id, attributes);
+    const uint64_t sfi = encoded.sfi;
+
+    auto it = segment.id_index.find(id);
+    if (it != segment.id_index.end()) {
+        const uint64_t old_sfi = segment.sfis.get(it->second);
+        segment.store_sfi(it->second, encoded); // Re-encode in place (widens columns if needed)
+        segment.dictionary.assign(it->second, sfi);
+        index_row(segment, it->second, old_sfi, sfi);
+        return it->second;
+    }
+
+    uint32_t ordinal = static_cast<uint32_t>(segment.sku_data.size());
+    segment.sku_data.push_back({segment.ids.copy(id)});
+    segment.store_sfi(ordinal, encoded);
+    if (!segment.load_position.empty()) { // New rows go last in catalog order too
+        segment.load_position.push_back(static_cast<uint32_t>(segment.ordinal_at_position.size()));
+        segment.ordinal_at_position.push_back(ordinal);
+    }
+    segment.id_index.emplace(segment.sku_data[ordinal].id, ordinal);
+    segment.dictionary.assign(ordinal, sfi);
+    index_row(segment, ordinal, 0, sfi);
+    return ordinal;
+}
+
+bool PrimeKit::remove_locked(Segment& segment, const std::string& id) {
+    auto it = segment.id_index.find(id);
+    if (it == segment.id_index.end()) return false;
+
+    const uint64_t old_sfi = segment.sfis.get(it->second);
+    segment.store_sfi(it->second, {0, 0, 0}); // Tombstone: 0 is skipped by every scan
+    segment.dictionary.assign(it->second, 0);
+    index_row(segment, it->second, old_sfi, 0);
+    segment.id_index.erase(it);
+    ++segment.tombstone_count;
+
+    // Compact once tombstones dominate, so removals stay O(1) amortized
+    // and scans never walk mostly-dead rows. This renumbers ordinals (see remove_sku).
+    if (segment.tombstone_count >= kAutoCompactTombstones && segment.tombstone_count * 2 >= segment.sku_data.size()) {
+        compact_locked(segment);
+    }
+    return true;
+}
+
+void PrimeKit::compact_locked(Segment& segment) {
+    if (segment.tombstone_count == 0) return;
+    segment.layout_version = segment.version; // Rows renumber; callers have bumped version
+    auto& sku_data = segment.sku_data;
+    // Columns are rebuilt from scratch, so they narrow again if wide SKUs were removed
+    SfiColumn sfis, master_sfis, local_sfis;
+    sfis.reserve(sku_data.size() - segment.tombstone_count);
+    Arena ids; // Live ids only, dropping those of removed and re-added SKUs
+    const bool split = segment.schema->split;
+    const bool clustered = !segment.load_position.empty();
+    std::vector<uint32_t> new_ordinal(clustered ? sku_data.size() : 0, UINT32_MAX);
+    size_t live = 0;
+    for (size_t i = 0; i < sku_data.size(); ++i) {
+        const uint64_t sfi = segment.sfis.get(i);
+        if (sfi != 0) {
+            if (live != i) sku_data[live] = std::move(sku_data[i]);
+            sku_data[live].id = ids.copy(sku_data[live].id);
+            sfis.push_back(sfi);
+            if (split) {
+                master_sfis.push_back(segment.master_sfis.get(i));
+                local_sfis.push_back(segment.local_sfis.get(i));
+            }
+            if (clustered) new_ordinal[i] = static_cast<uint32_t>(live);
+            ++live;
+        }
+    }
+    sku_data.resize(live);
+    segment.ids = std::move(ids); // id_index is rebuilt below
+    segment.sfis = std::move(sfis);
+    segment.master_sfis = std::move(master_sfis);
+    segment.local_sfis = std::move(local_sfis);
+
+    if (clustered) { // Renumber positions densely, keeping their relative order
+        std::vector<uint32_t> ordinal_at_position;
+        ordinal_at_position.reserve(live);
+        for (uint32_t old_ordinal : segment.ordinal_at_position) {
+            if (new_ordinal[old_ordinal] != UINT32_MAX) ordinal_at_position.push_back(new_ordinal[old_ordinal]);
+        }
+        segment.load_position.assign(live, 0);
+        for (uint32_t position = 0; position < live; ++position) {
+            segment.load_position[ordinal_at_position[position]] = position;
+        }
+        segment.ordinal_at_position = std::move(ordinal_at_position);
+    }
+    segment.tombstone_count = 0;
+    rebuild_indexes(segment);
+}
+
+uint32_t PrimeKit::upsert_sku(const std::string& id, const ItemAttributes& attributes) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    auto segment = current_segment();
+    std::unique_lock<std::shared_mutex> lock(segment->mutex);
+    segment->version = ++next_version_; // Cached results from before this change no longer apply
+    return upsert_locked(*segment, id, attributes);
+}
+
+uint32_t PrimeKit::upsert_sku_json(const std::string& id, const std::string& json_string) {
+    json attributes_json;
+    try {
+        attributes_json = json::parse(json_string);
+    } catch (json::parse_error& e) {
+        PK_LOG_ERROR("Failed to parse attributes JSON for SKU %s: %s", id.c_str(), e.what());
+        throw std::runtime_error("Failed to parse attributes JSON.");
+    }
+    if (!attributes_json.is_object()) {
+        throw std::runtime_error("Attributes JSON is not an object.");
+    }
+    return upsert_sku(id, attributes_from_json(attributes_json));
+}
+
+bool PrimeKit::remove_sku(const std::string& id) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    auto segment = current_segment();
+    std::unique_lock<std::shared_mutex> lock(segment->mutex);
+    // An unknown (or already removed) id changes nothing, so cached results
+    // and page cursors stay valid
+    if (segment->id_index.find(id) == segment->id_index.end()) return false;
+    segment->version = ++next_version_; // Cached results from before this change no longer apply
+    return remove_locked(*segment, id);
+}
+
+void PrimeKit::compact() {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    auto segment = current_segment();
+    std::unique_lock<std::shared_mutex> lock(segment->mutex);
+    segment->version = ++next_version_; // Cached results from before this change no longer apply
+    compact_locked(*segment);
+}
+
+size_t PrimeKit::tombstone_count() const {
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    return segment->tombstone_count;
+}
+
+uint64_t PrimeKit::prime_for(const std::string& attribute, const std::string& value) const {
+    return current_schema()->prime(attribute, value);
+}
+
+size_t PrimeKit::sku_count() const {
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    return segment->sku_data.size() - segment->tombstone_count;
+}
+
+ItemAttributes PrimeKit::decode_attributes(const Segment& segment, uint32_t ordinal) {
+    ItemAttributes attributes;
+    const PrimeFactorTable& prime_table = segment.schema->prime_table;
+    const auto& entries = prime_table.entries();
+    const auto& attribute_names = prime_table.attributes();
+    prime_table.factor(segment.sfis.get(ordinal), [&](uint32_t entry_index) {
+        const PrimeEntry& entry = entries[entry_index];
+        attributes[attribute_names[entry.attribute_index]].push_back(entry.value);
+    });
+    return attributes;
+}
+
+uint32_t PrimeKit::applyDelta(const std::string& json_string) {
+    json delta;
+    try {
+        delta = json::parse(json_string);
+    } catch (json::parse_error& e) {
+        PK_LOG_ERROR("Failed to parse delta JSON: %s", e.what());
+        throw std::runtime_error("Failed to parse delta JSON.");
+    }
+    if (!delta.is_object() || delta.value("format", "") != "primekit-delta") {
+        throw std::runtime_error("Invalid delta JSON: missing 'format': 'primekit-delta'.");
+    }
+    if (delta.value("version", 0) != 1) {
+        throw std::runtime_error("Unsupported delta version.");
+    }
+
+    // The whole delta lands under one exclusive lock, so queries see it all or none of it
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    auto segment = current_segment();
+    std::unique_lock<std::shared_mutex> lock(segment->mutex);
+
+    // Plan every change first, against the segment as it will be after the
+    // entries before it (nullopt = removed by this delta), and encode each
+    // upsert; an entry that overflows throws before anything has changed
+    struct DeltaOp {
+        std::string id;
+        std::optional<ItemAttributes> attributes; // nullopt = remove
+    };
+    std::vector<DeltaOp> ops;
+    std::unordered_map<std::string, std::optional<ItemAttributes>> planned;
+    auto is_live = [&](const std::string& id) {
+        auto it = planned.find(id);
+        return it != planned.end() ? it->second.has_value() : segment->id_index.count(id) != 0;
+    };
+    auto plan_upsert = [&](const std::string& id, ItemAttributes attributes) {
+        encode_sku(*segment, id, attributes);
+        planned[id] = attributes;
+        ops.push_back({id, std::move(attributes)});
+    };
+
+    // Removes first so an id that is removed and re-added in one delta ends up live
+    if (delta.contains("remove") && delta["remove"].is_array()) {
+        for (const auto& id : delta["remove"]) {
+            if (!id.is_string() || !is_live(id.get<std::string>())) continue;
+            planned[id.get<std::string>()] = std::nullopt;
+            ops.push_back({id.get<std::string>(), std::nullopt});
+        }
+    }
+
+    if (delta.contains("add") && delta["add"].is_array()) {
+        for (const auto& item : delta["add"]) {
+            if (!item.is_object() || !item.contains("id") || !item["id"].is_string()) continue;
+            plan_upsert(item["id"].get<std::string>(), attributes_from_json(item.value("attributes", json::object())));
+        }
+    }
+
+    if (delta.contains("update") && delta["update"].is_array()) {
+        for (const auto& item : delta["update"]) {
+            if (!item.is_object() || !item.contains("id") || !item["id"].is_string()) continue;
+            std::string id = item["id"].get<std::string>();
+            ItemAttributes changed = attributes_from_json(item.value("attributes", json::object()));
+            if (!is_live(id)) {
+                PK_LOG_WARN("Delta update for unknown SKU %s; inserting it.", id.c_str());
+                plan_upsert(id, std::move(changed));
+                continue;
+            }
+            // Overlay the changed keys on the SKU's current attribute values
+            auto it = planned.find(id);
+            ItemAttributes merged = it != planned.end() ? *it->second
+                                                        : decode_attributes(*segment, segment->id_index.at(id));
+            for (auto& [attr_key, values] : changed) {
+                merged[attr_key] = std::move(values);
+            }
+            plan_upsert(id, std::move(merged));
+        }
+    }
+
+    // Apply: nothing below can fail on the entries' content
+    if (ops.empty()) return 0; // Nothing changes, so cached results stay valid
+    segment->version = ++next_version_; // Cached results from before this change no longer apply
+    for (const DeltaOp& op : ops) {
+        if (op.attributes) {
+            upsert_locked(*segment, op.id, *op.attributes);
+        } else {
+            remove_locked(*segment, op.id);
+        }
+    }
+    return static_cast<uint32_t>(ops.size());
+}
+
+// Decodes a batch of SKUs (e.g. one page of filter results) back into attribute values
+std::vector<DecodedAttribute> PrimeKit::decode_batch(const std::vector<uint32_t>& ordinals) const {
+    std::vector<DecodedAttribute> decoded;
+    decoded.reserve(ordinals.size() * 4); // color, size and one or two materials is typical
+
+    auto segment = current_segment();
+    std::shared_lock<std::shared_mutex> lock(segment->mutex);
+    const PrimeFactorTable& prime_table = segment->schema->prime_table;
+    const auto& entries = prime_table.entries();
+    const auto& attributes = prime_table.attributes();
+    for (uint32_t ordinal : ordinals) {
+        if (ordinal >= segment->sku_data.size()) {
+            PK_LOG_WARN("decode_batch: ordinal %u out of range.", ordinal);
+            continue;
+        }
+        prime_table.factor(segment->sfis.get(ordinal), [&](uint32_t entry_index) {
+            const PrimeEntry& entry = entries[entry_index];
+            decoded.push_back({ordinal, attributes[entry.attribute_index], entry.value});
+        });
+    }
+    return decoded;
+}
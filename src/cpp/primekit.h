@@ -1,75 +1,524 @@
 #ifndef PRIME_KIT_H
 #define PRIME_KIT_H
 
+#include <array>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
-#include <tuple>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <optional>
+#include <string_view>
+#include "prime_table.h"
+#include "arena.h"
+#include "prime_hash_map.h"
+#include "static_schema.h"
+#include "schemas/apparel_vocabulary.h"
+#include "sfi_dictionary.h"
+#include "sfi_column.h"
+#include "zone_map.h"
+#include "posting_index.h"
+#include "result_cache.h"
+#include "result_buffer.h"
+#include "compiled_query.h"
+#include "engine_stats.h"
 
 // Type definitions
-using AttributeValueMap = std::unordered_map<std::string, uint64_t>;
-using PrimeDictionary = std::unordered_map<std::string, AttributeValueMap>;
 using ItemAttributes = std::unordered_map<std::string, std::vector<std::string>>;
 
-// Structure to hold internal SKU data (SKU ID and calculated SFIs)
+// Structure to hold internal SKU data. The SKU's SFI lives in the segment's
+// SfiColumn at the same ordinal, so scans stream SFIs without touching ids.
+// The id's bytes live in the segment's id arena.
 struct SkuData {
-    std::string id;
-    uint64_t sfi; // Single SFI value
-    // Removed master_sfi, local_sfi
+    std::string_view id;
 };
 
 // Structure for filter results including SFIs
 struct FilterResult {
     std::string id;
     uint64_t sfi; // Single SFI value for the result
-    // Removed masterSfi, localSfi
+    uint32_t ordinal; // Position in the loaded catalog, accepted by decode_batch
+};
+
+// One page of a paged query (PrimeKit::query_page); the rows themselves go
+// to a ResultBuffer
+struct QueryPage {
+    // Opaque continuation: pass it back for the next page; "" = last page
+    std::string next_cursor;
+    // Matches of the whole query (counted on the first page, carried in the cursor after that)
+    uint32_t total = 0;
+    uint32_t rows = 0; // Rows on this page
+};
+
+// One "more like this" result (PrimeKit::similar)
+struct SimilarItem {
+    std::string id;
+    uint64_t sfi;
+    uint32_t ordinal;
+    uint32_t shared; // Attribute values in common with the reference SKU
+};
+
+// One soft-match result (PrimeKit::soft_filter)
+struct SoftMatch {
+    std::string id;
+    uint64_t sfi;
+    uint32_t ordinal;
+    uint32_t matched; // Query values the SKU carries
+    double score;     // Sum of those values' attribute weights
+};
+
+// One decoded attribute value of a SKU (flat so a whole page decodes into one vector)
+struct DecodedAttribute {
+    uint32_t ordinal;
+    std::string attribute;
+    std::string value;
+};
+
+// Primes loaded by initializePrimesFromJson. Immutable once built; every
+// Segment keeps the schema its SFIs were encoded with. The same lookup
+// (with_lookup) encodes SKUs at load, on upserts and deltas, and resolves
+// query values through prime_for.
+struct PrimeSchema {
+    // (attribute, value) -> prime, for encoding SKUs and queries
+    PrimeHashMap primes;
+    // prime -> (attribute, value), used to decode SFIs
+    PrimeFactorTable prime_table;
+    // Set when the primes cover only the compile-time apparel vocabulary
+    // (src/cpp/schemas/); encoding then goes through it instead of `primes`
+    std::optional<StaticEncoder<ApparelVocabulary>> apparel_encoder;
+
+    // True when primes.json lists "master_attributes" / "local_attributes".
+    // Segments then keep each SFI's master and local parts as extra columns.
+    // Attributes in neither list count as local.
+    bool split = false;
+    // 1 for local attributes, by slot of the lookup with_lookup() passes on
+    std::vector<uint8_t> local_slots;
+    // 1 for local values, by prime_table entry index
+    std::vector<uint8_t> local_values;
+
+    // Calls fn with the lookup all encoding goes through: the static
+    // encoder when the primes bound to it, else the runtime map
+    template <typename Fn>
+    decltype(auto) with_lookup(Fn&& fn) const {
+        return apparel_encoder ? fn(*apparel_encoder) : fn(primes);
+    }
+    uint64_t prime(std::string_view attribute, std::string_view value) const {
+        return with_lookup([&](const auto& lookup) { return lookup.prime(attribute, value); });
+    }
+    bool is_local_slot(uint32_t slot) const { return slot < local_slots.size() && local_slots[slot]; }
+};
+
+// A SKU's SFI and its master and local parts (their product is the SFI)
+struct EncodedSfi {
+    uint64_t sfi = 1;
+    uint64_t master = 1;
+    uint64_t local = 1;
+};
+
+// One generation of loaded catalog data. initializeFromJson builds a fresh
+// Segment off to the side and publishes it with a single atomic pointer swap;
+// queries pin the generation they started on, so a reload never shows them a
+// half-built catalog. Incremental updates mutate the live generation under
+// its exclusive lock.
+struct Segment {
+    std::shared_ptr<const PrimeSchema> schema;
+
+    // Internal storage for processed SKU data
+    std::vector<SkuData> sku_data;
+    // Bytes of every SKU id in sku_data, freed with the segment. Ids of
+    // removed or re-added SKUs stay until compaction copies the live ones.
+    Arena ids;
+    // SFI per row, parallel to sku_data (0 = tombstone), at the narrowest width that fits
+    SfiColumn sfis;
+    // Master and local part of each SFI, parallel to sfis; filled only when
+    // schema->split. Each holds fewer primes than the full SFI, so it is
+    // often a narrower column, and queries on one side of the split scan it.
+    SfiColumn master_sfis;
+    SfiColumn local_sfis;
+    // SKU id -> ordinal in sku_data (live rows only); keys point into `ids`
+    std::unordered_map<std::string_view, uint32_t> id_index;
+    // Distinct SFIs and the rows carrying each, kept in step with sku_data
+    SfiDictionary dictionary;
+    // Values present per block of rows, so the row scan can skip blocks
+    ZoneMap zone_map;
+    // Rows and live-row counts per value: the planner's statistics, and the
+    // access path for selective queries. Readers sort lists lazily, under
+    // postings_mutex.
+    mutable PostingIndex postings;
+    mutable std::mutex postings_mutex;
+
+    // Set when the load clustered rows (PrimeKit::set_cluster_on_load): ordinal ->
+    // position in the original JSON order, and its inverse. Rows appended later
+    // take the next position. Results are returned in position order, so the
+    // reorder is invisible apart from ordinals. Both empty = identity.
+    std::vector<uint32_t> load_position;
+    std::vector<uint32_t> ordinal_at_position;
+    size_t tombstone_count = 0;
+    // Changes with every load and update; tags result cache entries
+    uint64_t version = 0;
+    // Version at which rows last changed position (load, compaction). Page
+    // cursors name a position, so they stay valid until this changes.
+    uint64_t layout_version = 0;
+
+    // Shared for queries, exclusive for in-place updates
+    mutable std::shared_mutex mutex;
+
+    const SfiColumn& column(SfiScope scope) const {
+        return scope == SfiScope::Master ? master_sfis : scope == SfiScope::Local ? local_sfis : sfis;
+    }
+    // Writes row `ordinal` (appending when it equals the row count) in every
+    // SFI column the schema keeps; {0, 0, 0} tombstones it
+    void store_sfi(uint32_t ordinal, const EncodedSfi& encoded) {
+        const bool append = ordinal == sfis.size();
+        auto store = [&](SfiColumn& column, uint64_t value) {
+            if (append) {
+                column.push_back(value);
+            } else {
+                column.set(ordinal, value);
+            }
+        };
+        store(sfis, encoded.sfi);
+        if (!schema->split) return;
+        store(master_sfis, encoded.master);
+        store(local_sfis, encoded.local);
+    }
 };
 
+class QueryCursor;
+
 // The core class for SFI encoding and filtering
 class PrimeKit {
 public:
+    // similar and soft_filter test distinct SFIs instead of rows while
+    // distinct SFIs * kDictionaryScanRatio <= rows
+    static constexpr size_t kDictionaryScanRatio = 4;
+
+    // Planner cost model for single queries, in units of one row-scan SFI test
+    static constexpr double kDictionaryCodeCost = 2.5; // Test one distinct SFI, skip its group
+    static constexpr double kPostingCost = 1.5;        // Look up and re-test one listed row
+    static constexpr double kGatherCost = 1.0;         // Copy out one matched ordinal
+    static constexpr double kSortCost = 0.5;           // Per ordinal per log2(result size), ordering small results
+
     PrimeKit();
     ~PrimeKit();
 
     // NEW: Initializes from a JSON string containing the inventory array
     void initializeFromJson(const std::string& inventoryJsonString);
 
-    // Processes a single item's JSON representation to calculate its SFIs
-    // Changed ItemData parameter to ItemAttributes
-    std::tuple<uint64_t, uint64_t> process_item_attributes(const ItemAttributes& item_attributes);
-
-    // Encodes SFI based on selected attributes and primes
-    // Changed ItemData parameter to ItemAttributes
-    uint64_t encode_sfi(const ItemAttributes& attributes, const std::vector<std::string>& relevant_keys, const PrimeDictionary& prime_dict);
-
     // Updated perform_filter to return vector<FilterResult> again
     std::vector<FilterResult> perform_filter(uint64_t query_sfi); // Single query SFI
 
-    // New method to load primes from JSON
+    // Same, with the query given as the selected values' primes instead of
+    // their product, so callers never build (or overflow) a 64-bit SFI.
+    // Primes <= 1 ("any") are ignored; repeats count once. A selection whose
+    // product exceeds 64 bits matches nothing, since no SFI is a multiple of it.
+    std::vector<FilterResult> perform_filter_primes(const uint32_t* primes, size_t count);
+    std::vector<FilterResult> perform_filter_primes(const std::vector<uint32_t>& primes) {
+        return perform_filter_primes(primes.data(), primes.size());
+    }
+
+    // Same queries, written into a caller-owned buffer instead of a fresh
+    // vector. Once `out` and the engine's scratch have grown to the working
+    // set, a query makes no heap allocations (EngineStats::last_allocations).
+    void perform_filter_into(uint64_t query_sfi, ResultBuffer& out);
+    void perform_filter_primes_into(const uint32_t* primes, size_t count, ResultBuffer& out);
+
+    // Evaluates many query SFIs against one generation. Each query is planned
+    // as perform_filter would plan it; those that would scan the rows (or the
+    // dictionary) share a single pass, where each block of SFIs is read from
+    // memory once and tested against every one of them. Empty, cached and
+    // posting-list queries are answered individually. Returns one result list
+    // per query, as perform_filter would.
+    std::vector<std::vector<FilterResult>> perform_filter_batch(const std::vector<uint64_t>& query_sfis);
+    // Same pass, returning only the number of matches per query (no ids are copied)
+    std::vector<uint32_t> perform_filter_batch_counts(const std::vector<uint64_t>& query_sfis);
+
+    // Up to `limit` matches of `query_sfi` in catalog order, starting where
+    // `cursor` (from the previous page; "" for the first) left off. Walks the
+    // planned access path only as far as the page needs, so later pages
+    // don't redo earlier ones; the first page also counts the total, unless
+    // its cursor comes from a finished QueryCursor (page_cursor()). Throws
+    // on a malformed cursor, one from another query, or one a reload or
+    // compaction has invalidated. In-place updates between pages are fine:
+    // pages continue from the same catalog position and total is recounted.
+    QueryPage query_page(uint64_t query_sfi, const std::string& cursor, uint32_t limit, ResultBuffer& out);
+    QueryPage query_page_primes(const uint32_t* primes, size_t count, const std::string& cursor, uint32_t limit,
+                                ResultBuffer& out);
+
+    // Starts `query_sfi` as a resumable, cancellable query (see query_cursor.h);
+    // nothing runs until its first step()
+    std::unique_ptr<QueryCursor> start_query(uint64_t query_sfi);
+    std::unique_ptr<QueryCursor> start_query_primes(const uint32_t* primes, size_t count);
+
+    // Up to k SKUs sharing the most attribute values with `sku_id`, i.e. with
+    // the most prime factors in gcd(their SFI, its SFI); most shared first,
+    // ties in catalog order. The SKU itself and rows sharing nothing are left
+    // out. An unknown id returns nothing.
+    std::vector<SimilarItem> similar(const std::string& sku_id, uint32_t k);
+
+    // --- Soft matching ---
+    // Ranks SKUs by how many of the query's values they carry instead of
+    // requiring all of them. Every SKU carrying at least `min_matched` of the
+    // n values scores the sum of those values' attribute weights, and the
+    // best `limit` come back, highest score first, ties in catalog order.
+    // min_matched = n is the strict filter, ranked; 0 counts as 1. Throws for
+    // more than kMaxSoftValues values.
+    std::vector<SoftMatch> soft_filter(uint64_t query_sfi, uint32_t min_matched, uint32_t limit);
+    std::vector<SoftMatch> soft_filter_primes(const uint32_t* primes, size_t count, uint32_t min_matched,
+                                              uint32_t limit);
+    // Weight of an attribute's values in soft_filter scores (default 1).
+    // Throws on a negative or non-finite weight.
+    void set_attribute_weight(const std::string& attribute, double weight);
+    static constexpr uint32_t kMaxSoftValues = 32;
+
+    // Runs a query like perform_filter and reports how it was executed: the
+    // access path the planner chose, its estimated vs actual rows, and the
+    // estimated cost of each alternative.
+    QueryPlan explain(uint64_t query_sfi);
+    // Memory for cached query results (default 8 MB); 0 turns the cache off
+    void set_result_cache_bytes(size_t bytes);
+
+    // New method to load primes from JSON: {"attribute_to_prime": {...}} plus
+    // optional "master_attributes" / "local_attributes" name lists
     void initializePrimesFromJson(const std::string& primesJsonString);
 
+    // When enabled, the next initializeFromJson stores SKUs clustered by
+    // attribute combination instead of JSON order, so matches form runs that
+    // zone maps can skip around. Results keep JSON order either way.
+    void set_cluster_on_load(bool enabled);
+
+    // --- Incremental updates ---
+    // Inserts a new SKU or re-encodes an existing one in place. Returns its ordinal.
+    // Throws if the attributes overflow a 64-bit SFI; the previous row is left intact.
+    uint32_t upsert_sku(const std::string& id, const ItemAttributes& attributes);
+    // Same, with attributes given as a JSON object string ({"color": ["Red"], ...})
+    uint32_t upsert_sku_json(const std::string& id, const std::string& attributesJsonString);
+    // Tombstones a SKU (its SFI becomes 0, which never matches). Returns false
+    // if unknown, without touching cached results or page cursors.
+    // Once at least kAutoCompactTombstones rows are tombstones and they make
+    // up half the segment, the removal also compacts (see compact()), so it
+    // can invalidate ordinals and page cursors just like compact() does.
+    bool remove_sku(const std::string& id);
+    // Drops tombstoned rows and rebuilds the id index. Invalidates previously
+    // returned ordinals (FilterResult::ordinal, for decode_batch) and
+    // query_page cursors.
+    void compact();
+    static constexpr size_t kAutoCompactTombstones = 1024;
+    size_t tombstone_count() const;
+
+    // Applies a segment delta (see tools/primekit_delta.cpp for the format):
+    //   {"format": "primekit-delta", "version": 1,
+    //    "remove": ["SKU1", ...],
+    //    "add":    [{"id": "SKU2", "attributes": {"color": ["Red"], ...}}, ...],
+    //    "update": [{"id": "SKU3", "attributes": {"size": ["M"]}}, ...]}
+    // "update" lists only the attribute keys that changed; other keys keep their
+    // current values. Every entry is encoded before anything changes, so a
+    // delta that throws (e.g. an SKU overflowing 64 bits) leaves the segment
+    // as it was. Returns the number of SKUs touched. Its removals can trigger
+    // the same automatic compaction as remove_sku.
+    uint32_t applyDelta(const std::string& deltaJsonString);
+
+    // Prime for an attribute value in the current schema, 1 if unknown (neutral in a query SFI)
+    uint64_t prime_for(const std::string& attribute, const std::string& value) const;
+    // Live (non-tombstoned) SKUs in the current generation
+    size_t sku_count() const;
+
+    // Snapshot of engine counters and per-phase timings (see engine_stats.h)
+    EngineStats get_stats() const;
+    void reset_stats();
+
+    // Factors the SFIs of the given SKU ordinals back into attribute values.
+    // Results are grouped by ordinal, in request order; unknown ordinals are skipped.
+    std::vector<DecodedAttribute> decode_batch(const std::vector<uint32_t>& ordinals) const;
+
     // Static method for explicit deletion from JS
     static void delete_(PrimeKit* instance) {
         delete instance;
     }
 
 private:
-    // Helper to get prime, returns 1 if not found
-    uint64_t get_prime(const PrimeDictionary& dict, const std::string& key, const std::string& value);
+    friend class QueryCursor; // Runs the planner and scan primitives one slice at a time
 
-    // Hardcoded prime dictionaries (replace JSON loading for now)
-    PrimeDictionary master_primes_;
-    PrimeDictionary local_primes_; // Example: Using one local dict for simplicity
-    // Define which attributes belong to master/local categories
-    std::vector<std::string> master_attribute_keys_;
-    std::vector<std::string> local_attribute_keys_;
+    // Generation currently visible to queries (never null)
+    std::shared_ptr<Segment> current_segment() const { return std::atomic_load(&segment_); }
+    std::shared_ptr<const PrimeSchema> current_schema() const { return std::atomic_load(&schema_); }
 
-    // Internal storage for processed SKU data
-    std::vector<SkuData> internal_sku_data_;
+    // Encodes a SKU's attributes with the segment's schema; throws on SFI overflow
+    static EncodedSfi encode_sku(const Segment& segment, const std::string& id, const ItemAttributes& attributes);
+    // Update primitives; the caller holds writer_mutex_ and segment.mutex exclusively
+    uint32_t upsert_locked(Segment& segment, const std::string& id, const ItemAttributes& attributes);
+    bool remove_locked(Segment& segment, const std::string& id);
+    void compact_locked(Segment& segment);
+
+    // Prepares a query SFI against the segment's schema (divisor, value ids, zone map mask)
+    static CompiledQuery compile_query(const Segment& segment, uint64_t query_sfi);
+    // Same, reusing `query`'s buffers
+    static void compile_query(const Segment& segment, uint64_t query_sfi, CompiledQuery& query);
+    // lcm of the primes (<= 1 ignored) in `query_sfi`; false if it exceeds 64 bits
+    static bool query_sfi_for_primes(const uint32_t* primes, size_t count, uint64_t& query_sfi);
+    // Moves row `ordinal` from old_sfi's values to new_sfi's in the zone map and posting lists
+    static void index_row(Segment& segment, uint32_t ordinal, uint64_t old_sfi, uint64_t new_sfi);
+
+    // Attribute values of a stored SKU, recovered by factoring its SFI
+    static ItemAttributes decode_attributes(const Segment& segment, uint32_t ordinal);
+
+    // A soft_filter candidate; QueryScratch::ranked keeps the best as a heap
+    struct RankedRow {
+        double score;
+        uint64_t position; // Catalog position, the tie-break
+        uint32_t ordinal;
+        uint32_t matched;
+    };
+
+    // Working buffers of one query or batch. Leased from scratch_pool_ and
+    // returned afterwards with their capacity, so steady-state queries don't
+    // allocate intermediate ordinal lists.
+    struct QueryScratch {
+        std::vector<uint32_t> matches;
+        std::vector<std::vector<uint32_t>> ordinals; // One list per query of a batch
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> pending;               // Batch queries that need the scan
+        std::vector<uint64_t> bitmap;                // Row bitmap for to_catalog_order
+        CompiledQuery query;                         // Single queries compile into this
+        std::vector<uint8_t> levels;                 // Values shared per row, for similar()
+        std::vector<RankedRow> ranked;               // soft_filter's top-K heap
+
+        size_t capacity_bytes() const;
+        // Buffers whose capacity changed since the last call, i.e. heap
+        // blocks taken by the work in between (a buffer that grew several
+        // times counts once)
+        uint64_t count_growth();
+
+    private:
+        std::array<size_t, 9> seen_capacity_{};
+    };
+    // Idle scratch kept for reuse; larger buffers are freed on return, so one
+    // huge result doesn't pin its memory
+    static constexpr size_t kScratchKeepBytes = 4 << 20;
+    static constexpr size_t kScratchPoolSize = 8;
+    class ScratchLease; // RAII lease, see primekit.cpp
+    std::unique_ptr<QueryScratch> acquire_scratch();
+    void release_scratch(std::unique_ptr<QueryScratch> scratch);
+
+    // Work done by one query (or batch)
+    struct ScanCounters {
+        uint64_t sfis_tested = 0;    // Rows, distinct SFIs or listed rows, depending on the path
+        uint64_t blocks_skipped = 0; // Row-scan blocks ruled out by the zone map
+        uint64_t cache_hits = 0;
+        uint64_t allocations = 0;    // Engine-owned buffers that grew, results cached
+
+        ScanCounters& operator+=(const ScanCounters& other) {
+            sfis_tested += other.sfis_tested;
+            blocks_skipped += other.blocks_skipped;
+            cache_hits += other.cache_hits;
+            allocations += other.allocations;
+            return *this;
+        }
+    };
+    // Estimates the cost of each access path for `query` and picks the cheapest
+    static QueryPlan plan_query(const Segment& segment, const CompiledQuery& query);
+    // Plans `query`, answers it from the result cache or the chosen path, and
+    // caches the result. Fills `matches` in catalog order; caller holds segment.mutex.
+    ScanCounters run_query(const Segment& segment, const CompiledQuery& query, std::vector<uint32_t>& matches,
+                           QueryPlan& plan, QueryScratch& scratch);
+    // Splits a batch into queries that share a row or dictionary pass and
+    // queries answered individually; caller holds segment.mutex
+    struct BatchPlan;
+    void plan_batch(const Segment& segment, const std::vector<CompiledQuery>& queries, BatchPlan& batch);
+    // Executes one query along `path` (not Cache)
+    static ScanCounters scan_matches(const Segment& segment, const CompiledQuery& query, AccessPath path,
+                                     std::vector<uint32_t>& matches, QueryScratch& scratch);
+    // Matches of a planned query, by the cheapest counting route
+    ScanCounters count_matches(const Segment& segment, const CompiledQuery& query, const QueryPlan& plan,
+                               uint32_t& total, QueryScratch& scratch);
+    // Appends to `matches` the first `limit` matches at catalog position
+    // >= `position`, in catalog order, walking only as far as needed
+    ScanCounters collect_page(const Segment& segment, const CompiledQuery& query, const QueryPlan& plan,
+                              uint64_t position, size_t limit, std::vector<uint32_t>& matches);
+    // Catalog position of a row
+    static uint64_t catalog_position(const Segment& segment, uint32_t ordinal) {
+        return segment.load_position.empty() ? ordinal : segment.load_position[ordinal];
+    }
+    // query_page cursor for the first page of a result whose size is already
+    // known (QueryCursor::page_cursor)
+    static std::string first_page_cursor(uint64_t query_sfi, uint64_t layout_version, uint64_t version,
+                                         uint64_t total);
+
+    // Values of the reference SKU that similar() scores against (further ones are ignored)
+    static constexpr uint32_t kMaxSimilarValues = 32;
+
+    // The values of one soft_filter query: a divisor per value, its value id
+    // (kNoValue for a prime outside the schema) and its weight
+    struct SoftQuery {
+        static constexpr uint32_t kNoValue = UINT32_MAX;
+        std::array<FastDivisor, kMaxSoftValues> divisors;
+        std::array<uint32_t, kMaxSoftValues> value_ids;
+        std::array<double, kMaxSoftValues> weights;
+        uint32_t count = 0;
+    };
+    // Adds one value (a prime, or an unfactored remainder) to `query`, weighted from attribute_weights_
+    void add_soft_value(const Segment& segment, SoftQuery& query, uint64_t divisor, uint32_t value_id) const;
+    // Runs a prepared soft query against the current generation
+    std::vector<SoftMatch> run_soft_filter(const std::shared_ptr<Segment>& segment, const SoftQuery& query,
+                                           uint32_t min_matched, uint32_t limit);
+
+    // Value id of the query's rarest value, whose posting list it then sorts
+    static uint32_t posting_driver(const Segment& segment, const CompiledQuery& query);
+    // Walks the posting list of the query's rarest value, re-testing each row
+    static ScanCounters scan_postings(const Segment& segment, const CompiledQuery& query, std::vector<uint32_t>& matches,
+                                      QueryScratch& scratch);
+    // Evaluates query_count queries in one pass over the segment, by distinct
+    // SFI or by row scan. Always fills counts; with `ordinals` also one
+    // catalog-ordered ordinal list per query. `ordinals` and `counts` may be
+    // scratch's own buffers.
+    static ScanCounters scan_batch(const Segment& segment, const CompiledQuery* queries, size_t query_count,
+                                   std::vector<std::vector<uint32_t>>* ordinals, std::vector<uint32_t>& counts,
+                                   bool use_dictionary, QueryScratch& scratch);
+
+    // Runs one query and calls materialize(segment, matches), which returns
+    // the allocations it made; shared by perform_filter and perform_filter_into
+    template <typename Materialize>
+    void filter_single(uint64_t query_sfi, Materialize&& materialize);
+
+    // Folds one query's (or one batch's) counters into stats_
+    void record_query(const ScanCounters& counters, uint64_t matches, double scan_ms, double materialize_ms,
+                      uint64_t query_count = 1);
+
+    // Permutes a freshly parsed segment into clustered order and records load_position
+    static void cluster_rows(Segment& segment);
+    // Sorts matched ordinals into catalog (load) order; `bitmap` is working space
+    static void to_catalog_order(const Segment& segment, std::vector<uint32_t>& ordinals, std::vector<uint64_t>& bitmap);
+
+    // Rebuilds segment.id_index, dictionary, zone_map and postings from sku_data and sfis (after load or compaction)
+    static void rebuild_indexes(Segment& segment);
+
+    // Published state; read and replaced only through std::atomic_load / std::atomic_store
+    std::shared_ptr<Segment> segment_;
+    std::shared_ptr<const PrimeSchema> schema_; // Used by the next initializeFromJson
+
+    // Serializes writers (publishes and in-place updates); readers never take it
+    std::mutex writer_mutex_;
+
+    std::atomic<bool> cluster_on_load_{false};
+
+    // set_attribute_weight values by attribute name; read per soft_filter query
+    std::unordered_map<std::string, double> attribute_weights_;
+    mutable std::mutex weights_mutex_;
+
+    // Source of Segment::version values; never reused, so entries computed on
+    // an older generation can't be mistaken for current ones
+    std::atomic<uint64_t> next_version_{0};
+    ResultCache result_cache_;
+
+    std::vector<std::unique_ptr<QueryScratch>> scratch_pool_;
+    std::mutex scratch_mutex_;
 
-    // --- New structure for combined primes ---
-    std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> attribute_prime_map;
+    // Updated once per load/query, after the work is done
+    EngineStats stats_;
+    mutable std::mutex stats_mutex_;
 };
 
 #endif // PRIME_KIT_H 
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "query_cursor.h"
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+
+QueryCursor::QueryCursor(PrimeKit& kit, uint64_t query_sfi)
+    : kit_(kit), segment_(kit.current_segment()), query_sfi_(query_sfi) {}
+
+void QueryCursor::begin_locked() {
+    const Segment& segment = *segment_;
+    version_ = segment.version;
+    layout_version_ = segment.layout_version;
+    matches_.clear();
+    next_ = 0;
+    total_ = 0;
+    counters_ = PrimeKit::ScanCounters();
+    source_ = Source::None;
+
+    PrimeKit::compile_query(segment, query_sfi_, query_);
+    const QueryPlan plan = PrimeKit::plan_query(segment, query_);
+    path_ = plan.path;
+    if (path_ == AccessPath::Empty) return;
+    if (path_ != AccessPath::All) {
+        if (auto cached = kit_.result_cache_.find(version_, query_sfi_)) {
+            matches_.assign(cached->begin(), cached->end());
+            path_ = AccessPath::Cache;
+            counters_.cache_hits = 1;
+            return;
+        }
+    }
+
+    switch (path_) {
+        case AccessPath::All:
+            source_ = Source::Positions;
+            total_ = segment.sfis.size();
+            break;
+        case AccessPath::Postings:
+            source_ = Source::Postings;
+            driver_ = PrimeKit::posting_driver(segment, query_);
+            total_ = segment.postings.list_size(driver_);
+            break;
+        default:
+            // The dictionary path tests distinct SFIs, whose groups interleave
+            // through the catalog; scanning rows keeps partial results ordered
+            path_ = AccessPath::Scan;
+            source_ = Source::Rows;
+            total_ = segment.sfis.size();
+            break;
+    }
+    // Growing a large match list in one slice would copy it all at once
+    matches_.reserve(static_cast<size_t>(std::min(plan.estimated_rows * 1.25, static_cast<double>(total_))));
+}
+
+void QueryCursor::run_slice() {
+    const Segment& segment = *segment_;
+    const size_t begin = next_;
+    const size_t end = std::min(total_, begin + kSliceRows);
+    next_ = end;
+
+    if (source_ == Source::Positions) {
+        const auto& ordinal_at_position = segment.ordinal_at_position;
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t ordinal = ordinal_at_position.empty() ? static_cast<uint32_t>(i) : ordinal_at_position[i];
+            if (segment.sfis.get(ordinal) != 0) matches_.push_back(ordinal); // Skip tombstones
+        }
+        return;
+    }
+
+    if (source_ == Source::Postings) {
+        // Lists hold stale entries (re-encoded or removed rows), so every row is re-tested
+        const std::vector<uint32_t>& list = segment.postings.list(driver_);
+        segment.column(query_.scope).visit([&](const auto& column) {
+            for (size_t i = begin; i < end; ++i) {
+                const uint64_t sfi = column[list[i]];
+                if (sfi != 0 && query_.divisor.divides(sfi)) matches_.push_back(list[i]);
+            }
+        });
+        counters_.sfis_tested += end - begin;
+        return;
+    }
+
+    // kSliceRows is one zone map block, so a slice is skipped or scanned whole
+    const ZoneMap& zone_map = segment.zone_map;
+    const size_t block = begin / ZoneMap::kBlockRows;
+    if (!query_.value_mask.empty() &&
+        (block >= zone_map.block_count() || !zone_map.may_contain(block, query_.value_mask))) {
+        ++counters_.blocks_skipped;
+        return;
+    }
+    segment.column(query_.scope).visit([&](const auto& column) {
+        scan_divisible(column, begin, end, query_.divisor, matches_);
+    });
+    counters_.sfis_tested += end - begin;
+}
+
+void QueryCursor::finish_locked() {
+    const Segment& segment = *segment_;
+    // Positions and cached results are already in catalog order
+    if ((source_ == Source::Rows || source_ == Source::Postings) && !segment.load_position.empty()) {
+        PrimeKit::to_catalog_order(segment, matches_, bitmap_);
+    }
+    if (source_ != Source::None && source_ != Source::Positions && kit_.result_cache_.admits(matches_.size())) {
+        kit_.result_cache_.insert(version_, query_sfi_, std::make_shared<const std::vector<uint32_t>>(matches_));
+        ++counters_.allocations;
+    }
+    if (matches_.capacity() != seen_capacity_) ++counters_.allocations;
+    seen_capacity_ = matches_.capacity();
+    kit_.record_query(counters_, matches_.size(), elapsed_ms_, 0);
+    done_ = true;
+}
+
+bool QueryCursor::step(uint32_t budget_us) {
+    if (done()) return true;
+    const auto start = StatsClock::now();
+    const auto deadline = start + std::chrono::microseconds(budget_us);
+
+    std::shared_lock<std::shared_mutex> lock(segment_->mutex);
+    if (!started_ || segment_->version != version_) {
+        if (started_) ++restarts_;
+        begin_locked();
+        started_ = true;
+    }
+    // Growth from earlier steps is counted once, when the query finishes
+    do {
+        if (next_ >= total_) break;
+        run_slice();
+    } while (!cancelled() && StatsClock::now() < deadline);
+
+    elapsed_ms_ += elapsed_ms(start, StatsClock::now());
+    if (!cancelled() && next_ >= total_) finish_locked();
+    return done();
+}
+
+double QueryCursor::progress() const {
+    if (done_) return 1;
+    return total_ == 0 ? 0 : static_cast<double>(next_) / static_cast<double>(total_);
+}
+
+std::string QueryCursor::page_cursor() const {
+    if (!done_ || cancelled()) return "";
+    return PrimeKit::first_page_cursor(query_sfi_, layout_version_, version_, matches_.size());
+}
+
+void QueryCursor::read_into(size_t from, ResultBuffer& out) const {
+    std::shared_lock<std::shared_mutex> lock(segment_->mutex);
+    const bool current = started_ && segment_->version == version_;
+    const size_t count = current && from < matches_.size() ? matches_.size() - from : 0;
+    out.begin(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t ordinal = matches_[from + i];
+        out.append(ordinal, segment_->sfis.get(ordinal), segment_->sku_data[ordinal].id);
+    }
+    out.finish();
+}
@@ -0,0 +1,102 @@
+#ifndef QUERY_CURSOR_H
+#define QUERY_CURSOR_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "primekit.h"
+
+// A single query executed in time-boxed slices, so a host with one thread
+// (the browser main thread) can interleave a scan of a huge segment with
+// input handling. Created by PrimeKit::start_query; each step(budget_us)
+// works for about that long and returns true once the query is finished.
+//
+// The cursor pins the generation it started on, like any query, but takes
+// the segment's shared lock only inside step() and read_into(). If an
+// in-place update lands between steps, the next step starts the query over
+// (restarts() counts this), so a finished cursor always reflects one version.
+//
+// cancel() is the cancellation token: it may be called from any thread,
+// including while another thread is inside step(), which then stops at the
+// next block. A cancelled query is not cached or counted in the stats.
+//
+// Matches found so far can be read between steps for progressive rendering.
+// They are in catalog order, except on clustered segments
+// (PrimeKit::set_cluster_on_load), where partial matches come in storage
+// order and the final step reorders them: re-read from 0 once done().
+//
+// The PrimeKit must outlive its cursors. Apart from cancel(), a cursor is
+// not thread-safe.
+class QueryCursor {
+public:
+    QueryCursor(PrimeKit& kit, uint64_t query_sfi);
+    QueryCursor(const QueryCursor&) = delete;
+    QueryCursor& operator=(const QueryCursor&) = delete;
+
+    // Rows (or listed rows) examined per slice between clock checks
+    static constexpr uint32_t kSliceRows = ZoneMap::kBlockRows;
+
+    // Works for about budget_us microseconds (at least one slice); true when done
+    bool step(uint32_t budget_us);
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    bool done() const { return done_ || cancelled(); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+    // Fraction of the chosen access path's input examined, 0..1
+    double progress() const;
+    size_t match_count() const { return matches_.size(); }
+    // Times an update between steps forced the query to start over
+    uint32_t restarts() const { return restarts_; }
+    // access_path_name() of the plan being executed ("" before the first step)
+    const char* strategy() const { return started_ ? access_path_name(path_) : ""; }
+
+    // Writes matches [from, match_count()) into `out`. Writes nothing when an
+    // update has invalidated the matches (the next step starts over).
+    void read_into(size_t from, ResultBuffer& out) const;
+    // A PrimeKit::query_page cursor for the first page of the finished
+    // result. It carries match_count() as the total, so query_page does not
+    // count the matches again unless the catalog has changed since. "" until
+    // done(), and for a cancelled query.
+    std::string page_cursor() const;
+
+private:
+    // Where the remaining work comes from
+    enum class Source {
+        None,      // Nothing left: empty plan or cached result
+        Positions, // Every live row, in catalog order (query SFI 1)
+        Rows,      // Row scan of the query's column, zone maps skipping blocks
+        Postings,  // The driving value's posting list, each row re-tested
+    };
+
+    // Compiles and plans the query against the current version; caller holds the shared lock
+    void begin_locked();
+    // Examines up to kSliceRows rows of the source
+    void run_slice();
+    // Orders, caches and records the finished result
+    void finish_locked();
+
+    PrimeKit& kit_;
+    std::shared_ptr<Segment> segment_;
+    uint64_t query_sfi_;
+    uint64_t version_ = 0; // Segment version the matches belong to
+    uint64_t layout_version_ = 0;
+    CompiledQuery query_;
+    AccessPath path_ = AccessPath::Scan;
+    Source source_ = Source::None;
+    uint32_t driver_ = 0; // Posting list value id, for Source::Postings
+    size_t next_ = 0;     // Next position, row or list index
+    size_t total_ = 0;
+    std::vector<uint32_t> matches_;
+    std::vector<uint64_t> bitmap_; // to_catalog_order working space
+    PrimeKit::ScanCounters counters_;
+    size_t seen_capacity_ = 0;     // matches_ capacity, to count its growth
+    double elapsed_ms_ = 0;        // Summed over steps
+    bool started_ = false;
+    bool done_ = false;
+    uint32_t restarts_ = 0;
+    std::atomic<bool> cancelled_{false};
+};
+
+#endif // QUERY_CURSOR_H
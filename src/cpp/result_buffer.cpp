@@ -0,0 +1,63 @@
+#include "result_buffer.h"
+#include <algorithm>
+
+template <typename T>
+void ResultBuffer::reserve(std::vector<T>& column, size_t needed) {
+    if (needed <= column.capacity()) return;
+    column.reserve(std::max(needed, column.capacity() * 2));
+    ++allocations_;
+}
+
+template <typename T>
+bool ResultBuffer::oversized(const std::vector<T>& column, size_t floor) {
+    return column.capacity() > floor && column.capacity() > column.size() * 4;
+}
+
+template <typename T>
+void ResultBuffer::trim(std::vector<T>& column, size_t floor) {
+    if (!oversized(column, floor)) return;
+    std::vector<T> smaller;
+    smaller.reserve(std::max(floor, column.size() * 2));
+    smaller.assign(column.begin(), column.end());
+    column.swap(smaller);
+    ++allocations_;
+}
+
+void ResultBuffer::begin(size_t rows) {
+    ordinals_.clear();
+    sfis_.clear();
+    id_offsets_.clear();
+    id_bytes_.clear();
+    reserve(ordinals_, rows);
+    reserve(sfis_, rows);
+    reserve(id_offsets_, rows + 1);
+    id_offsets_.push_back(0);
+}
+
+void ResultBuffer::append(uint32_t ordinal, uint64_t sfi, std::string_view id) {
+    reserve(ordinals_, ordinals_.size() + 1);
+    reserve(sfis_, sfis_.size() + 1);
+    reserve(id_offsets_, id_offsets_.size() + 1);
+    reserve(id_bytes_, id_bytes_.size() + id.size());
+    ordinals_.push_back(ordinal);
+    sfis_.push_back(sfi);
+    id_bytes_.insert(id_bytes_.end(), id.begin(), id.end());
+    id_offsets_.push_back(static_cast<uint32_t>(id_bytes_.size()));
+}
+
+void ResultBuffer::finish() {
+    const size_t id_floor = watermark_rows_ * kTypicalIdBytes;
+    const bool idle = oversized(ordinals_, watermark_rows_) || oversized(id_bytes_, id_floor);
+    oversized_results_ = idle ? oversized_results_ + 1 : 0;
+    if (oversized_results_ < kTrimAfterResults) return;
+    oversized_results_ = 0;
+    trim(ordinals_, watermark_rows_);
+    trim(sfis_, watermark_rows_);
+    trim(id_offsets_, watermark_rows_ + 1);
+    trim(id_bytes_, id_floor);
+}
+
+size_t ResultBuffer::capacity_bytes() const {
+    return ordinals_.capacity() * sizeof(uint32_t) + sfis_.capacity() * sizeof(uint64_t) +
+           id_offsets_.capacity() * sizeof(uint32_t) + id_bytes_.capacity();
+}
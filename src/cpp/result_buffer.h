@@ -0,0 +1,73 @@
+#ifndef RESULT_BUFFER_H
+#define RESULT_BUFFER_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Caller-owned, reusable destination for query results (see
+// PrimeKit::perform_filter_into). Results are stored column-wise: ordinals,
+// SFIs, and all ids back to back in one byte buffer with an offset per row,
+// so a result of any size lives in four blocks instead of one string per
+// match. Each query overwrites the previous result in place; buffers grow
+// geometrically and are only given back once they have exceeded both the
+// watermark and four times what the result needed for kTrimAfterResults
+// results in a row. A stream of queries, even alternating broad and narrow
+// ones, then allocates nothing.
+//
+// From JS the columns are exposed as typed-array views straight into WASM
+// memory (see bindings.cpp). A view is only good until the next query into
+// the buffer, or until the WASM heap grows; copy out what must outlive it.
+class ResultBuffer {
+public:
+    // Rows of capacity that are never released (ids are sized at kTypicalIdBytes per row)
+    static constexpr size_t kDefaultWatermarkRows = 64 * 1024;
+    static constexpr size_t kTypicalIdBytes = 16;
+    static constexpr uint32_t kTrimAfterResults = 16;
+
+    explicit ResultBuffer(size_t watermark_rows = kDefaultWatermarkRows) : watermark_rows_(watermark_rows) {}
+
+    // Starts a new result with room for `rows` rows, dropping the previous one
+    void begin(size_t rows);
+    void append(uint32_t ordinal, uint64_t sfi, std::string_view id);
+    // Ends the result, releasing capacity that a run of much smaller results left idle
+    void finish();
+
+    size_t size() const { return ordinals_.size(); }
+    const uint32_t* ordinals() const { return ordinals_.data(); }
+    const uint64_t* sfis() const { return sfis_.data(); }
+    // size() + 1 entries: id i is id_bytes()[id_offsets()[i] .. id_offsets()[i + 1])
+    const uint32_t* id_offsets() const { return id_offsets_.data(); }
+    const char* id_bytes() const { return id_bytes_.data(); }
+    size_t id_bytes_size() const { return id_bytes_.size(); }
+    std::string_view id(size_t row) const {
+        return std::string_view(id_bytes_.data() + id_offsets_[row], id_offsets_[row + 1] - id_offsets_[row]);
+    }
+
+    void set_watermark_rows(size_t rows) { watermark_rows_ = rows; }
+    size_t capacity_bytes() const;
+    // Heap blocks taken (grown or trimmed buffers) over the buffer's lifetime
+    uint64_t allocations() const { return allocations_; }
+
+private:
+    // Grows `column` to hold `needed` elements, at least doubling it
+    template <typename T>
+    void reserve(std::vector<T>& column, size_t needed);
+    // Whether `column` holds over 4x its size and more than `floor`
+    template <typename T>
+    static bool oversized(const std::vector<T>& column, size_t floor);
+    // Reallocates an oversized `column` smaller
+    template <typename T>
+    void trim(std::vector<T>& column, size_t floor);
+
+    std::vector<uint32_t> ordinals_;
+    std::vector<uint64_t> sfis_;
+    std::vector<uint32_t> id_offsets_;
+    std::vector<char> id_bytes_;
+    size_t watermark_rows_;
+    uint32_t oversized_results_ = 0; // Consecutive results that left the buffer oversized
+    uint64_t allocations_ = 0;
+};
+
+#endif // RESULT_BUFFER_H
@@ -0,0 +1,60 @@
+#include "result_cache.h"
+
+void ResultCache::reset_locked(uint64_t version) {
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+    version_ = version;
+}
+
+ResultCache::Ordinals ResultCache::find(uint64_t version, uint64_t query_sfi) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (version != version_) {
+        if (version > version_) reset_locked(version); // Old generations never evict newer results
+        return nullptr;
+    }
+    auto it = index_.find(query_sfi);
+    if (it == index_.end()) return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->ordinals;
+}
+
+void ResultCache::insert(uint64_t version, uint64_t query_sfi, Ordinals ordinals) {
+    if (!admits(ordinals->size())) return;
+    const size_t bytes = ordinals->size() * sizeof(uint32_t);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (version != version_) {
+        if (version < version_) return; // Computed on data that has since changed
+        reset_locked(version);
+    }
+    auto it = index_.find(query_sfi);
+    if (it != index_.end()) { // Raced with another reader computing the same query
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.push_front({query_sfi, std::move(ordinals)});
+    index_.emplace(query_sfi, lru_.begin());
+    bytes_ += bytes;
+    evict_locked();
+}
+
+void ResultCache::evict_locked() {
+    while (bytes_ > byte_budget_ && !lru_.empty()) {
+        const Entry& victim = lru_.back();
+        bytes_ -= victim.ordinals->size() * sizeof(uint32_t);
+        index_.erase(victim.query_sfi);
+        lru_.pop_back();
+    }
+}
+
+void ResultCache::set_budget(size_t byte_budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    byte_budget_ = byte_budget;
+    evict_locked();
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reset_locked(version_);
+}
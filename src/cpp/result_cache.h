@@ -0,0 +1,56 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Small LRU cache of query results (matching ordinals in catalog order),
+// keyed by query SFI and tagged with the data version they were computed on.
+// Any load or update bumps the version, and the first lookup or insert at a
+// new version empties the cache, so a hit is always current. Entries are
+// bounded by total ordinal bytes; results larger than a quarter of the budget
+// are not cached at all (broad queries are cheap to rescan anyway).
+class ResultCache {
+public:
+    using Ordinals = std::shared_ptr<const std::vector<uint32_t>>;
+
+    static constexpr size_t kDefaultByteBudget = 8u << 20;
+
+    explicit ResultCache(size_t byte_budget = kDefaultByteBudget) : byte_budget_(byte_budget) {}
+
+    // Whether a result of this many ordinals would be kept (check before copying one)
+    bool admits(size_t ordinal_count) const {
+        return byte_budget_ != 0 && ordinal_count * sizeof(uint32_t) * 4 <= byte_budget_;
+    }
+
+    // Cached ordinals for the query at this version, or null
+    Ordinals find(uint64_t version, uint64_t query_sfi);
+    void insert(uint64_t version, uint64_t query_sfi, Ordinals ordinals);
+    void clear();
+    // Changes the byte budget, evicting as needed; 0 disables caching
+    void set_budget(size_t byte_budget);
+
+private:
+    void reset_locked(uint64_t version);
+    void evict_locked();
+
+    struct Entry {
+        uint64_t query_sfi;
+        Ordinals ordinals;
+    };
+
+    std::mutex mutex_;
+    uint64_t version_ = 0;
+    std::list<Entry> lru_; // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    size_t bytes_ = 0;
+    std::atomic<size_t> byte_budget_;
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,60 @@
+// Generated by primekit_schema_gen from data/segments/BrandA/primes.json. Do not edit; regenerate with
+//   primekit_schema_gen <primes.json> ApparelVocabulary <this file>
+#ifndef APPAREL_VOCABULARY_H
+#define APPAREL_VOCABULARY_H
+
+#include "static_schema.h"
+
+struct ApparelVocabulary {
+    static constexpr uint32_t kAttributeCount = 3;
+    static constexpr uint32_t kValueCount = 31;
+
+    static constexpr std::array<std::string_view, kAttributeCount> kAttributes = {
+        "color",
+        "material",
+        "size",
+    };
+
+    static constexpr std::array<StaticValue, kValueCount> kValues = {{
+        {0, "Black"},
+        {0, "Blue"},
+        {0, "Brown"},
+        {0, "Cyan"},
+        {0, "Gray"},
+        {0, "Green"},
+        {0, "Orange"},
+        {0, "Pink"},
+        {0, "Purple"},
+        {0, "Red"},
+        {0, "White"},
+        {0, "Yellow"},
+        {1, "Corduroy"},
+        {1, "Cotton"},
+        {1, "Denim"},
+        {1, "Fleece"},
+        {1, "Leatherette"},
+        {1, "Linen"},
+        {1, "Nylon"},
+        {1, "Polyester"},
+        {1, "Rayon"},
+        {1, "Silk"},
+        {1, "Spandex Blend"},
+        {1, "Wool"},
+        {2, "3XL"},
+        {2, "L"},
+        {2, "M"},
+        {2, "S"},
+        {2, "XL"},
+        {2, "XS"},
+        {2, "XXL"},
+    }};
+
+    static constexpr uint32_t kSeed = 197;
+    static constexpr bool kFullHash = false;
+    static constexpr uint32_t kAttributeTableBits = 2;
+    static constexpr std::array<uint32_t, kAttributeCount> kValueTableBits = {5, 5, 4};
+};
+
+static_assert(StaticLookup<ApparelVocabulary>::consistent(), "ApparelVocabulary hash tables have a collision");
+
+#endif // APPAREL_VOCABULARY_H
@@ -0,0 +1,170 @@
+#ifndef SFI_COLUMN_H
+#define SFI_COLUMN_H
+
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include "prime_table.h"
+
+// A segment's SFIs stored in the narrowest unsigned width that holds all of
+// them: 16, 32 or 64 bits. Small schemas (a handful of low primes) often fit
+// in 16 bits and typical apparel segments in 32, which halves or quarters the
+// bytes a filter scan streams through compared with a uint64_t per SKU.
+//
+// Writes that don't fit the current width widen the column in place (a
+// one-off copy); nothing narrows it again until it is rebuilt, e.g. by
+// compaction. Readers dispatch once per scan through visit(), which hands
+// the typed vector to a width-specialized kernel.
+class SfiColumn {
+public:
+    // Calls fn with the typed storage (const std::vector<uint16_t/uint32_t/uint64_t>&)
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) const {
+        if (width_ == 16) return fn(data16_);
+        if (width_ == 32) return fn(data32_);
+        return fn(data64_);
+    }
+
+    static uint32_t width_for(uint64_t sfi) {
+        if (sfi <= UINT16_MAX) return 16;
+        if (sfi <= UINT32_MAX) return 32;
+        return 64;
+    }
+
+private:
+    template <typename Fn>
+    decltype(auto) visit_mutable(Fn&& fn) {
+        if (width_ == 16) return fn(data16_);
+        if (width_ == 32) return fn(data32_);
+        return fn(data64_);
+    }
+
+public:
+    void clear() {
+        width_ = 16;
+        data16_.clear();
+        data32_.clear();
+        data64_.clear();
+    }
+
+    void reserve(size_t count) {
+        visit_mutable([&](auto& data) { data.reserve(count); });
+    }
+
+    size_t size() const {
+        return visit([](const auto& data) { return data.size(); });
+    }
+
+    uint32_t width() const { return width_; }
+
+    // Largest value the current width can hold
+    uint64_t max_value() const {
+        return width_ == 16 ? UINT16_MAX : width_ == 32 ? UINT32_MAX : UINT64_MAX;
+    }
+
+    uint64_t get(size_t index) const {
+        return visit([&](const auto& data) { return static_cast<uint64_t>(data[index]); });
+    }
+
+    void set(size_t index, uint64_t sfi) {
+        fit(sfi);
+        visit_mutable([&](auto& data) {
+            data[index] = static_cast<typename std::decay_t<decltype(data)>::value_type>(sfi);
+        });
+    }
+
+    void push_back(uint64_t sfi) {
+        fit(sfi);
+        visit_mutable([&](auto& data) {
+            data.push_back(static_cast<typename std::decay_t<decltype(data)>::value_type>(sfi));
+        });
+    }
+
+private:
+    // Widens the storage so sfi fits
+    void fit(uint64_t sfi) {
+        const uint32_t needed = width_for(sfi);
+        if (needed <= width_) return;
+        std::vector<uint64_t> values;
+        values.reserve(size());
+        visit([&](const auto& data) { values.assign(data.begin(), data.end()); });
+        data16_ = {};
+        data32_ = {};
+        width_ = needed;
+        if (width_ == 32) {
+            data32_.assign(values.begin(), values.end());
+        } else {
+            data64_ = std::move(values);
+        }
+    }
+
+    uint32_t width_ = 16;
+    std::vector<uint16_t> data16_;
+    std::vector<uint32_t> data32_;
+    std::vector<uint64_t> data64_;
+};
+
+// Scan kernel, instantiated per column width. Appends the positions in
+// [begin, end) of nonzero SFIs divisible by the query to `out`. The output
+// slot is written unconditionally and only kept on a match, so the loop has
+// no data-dependent branch; the test itself is FastDivisor's multiply-compare.
+template <typename T>
+void scan_divisible(const std::vector<T>& sfis, size_t begin, size_t end, const FastDivisor& query,
+                    std::vector<uint32_t>& out) {
+    const size_t base = out.size();
+    out.resize(base + (end - begin));
+    uint32_t* slot = out.data() + base;
+    size_t found = 0;
+    const T* data = sfis.data();
+    for (size_t i = begin; i < end; ++i) {
+        const uint64_t sfi = data[i];
+        slot[found] = static_cast<uint32_t>(i);
+        found += (sfi != 0) & query.divides(sfi);
+    }
+    out.resize(base + found);
+}
+
+// Counting variant of scan_divisible for batch counts: nothing is written
+template <typename T>
+size_t count_divisible(const std::vector<T>& sfis, size_t begin, size_t end, const FastDivisor& query) {
+    size_t found = 0;
+    const T* data = sfis.data();
+    for (size_t i = begin; i < end; ++i) {
+        const uint64_t sfi = data[i];
+        found += (sfi != 0) & query.divides(sfi);
+    }
+    return found;
+}
+
+// Number of `divisors` dividing `sfi` (0 for a tombstone). With the
+// reference SKU's value primes as divisors, this is how many values the two
+// share: the prime factors of their gcd.
+inline uint32_t count_dividing(uint64_t sfi, const FastDivisor* divisors, uint32_t count) {
+    uint32_t found = 0;
+    for (uint32_t j = 0; j < count; ++j) found += divisors[j].divides(sfi);
+    return sfi == 0 ? 0 : found;
+}
+
+// Bit j set when divisors[j] divides `sfi` (none for a tombstone): which
+// of a soft query's values the row carries
+inline uint32_t divisor_bits(uint64_t sfi, const FastDivisor* divisors, uint32_t count) {
+    uint32_t bits = 0;
+    for (uint32_t j = 0; j < count; ++j) bits |= static_cast<uint32_t>(divisors[j].divides(sfi)) << j;
+    return sfi == 0 ? 0 : bits;
+}
+
+// Similarity kernel: count_dividing for every row into levels, plus a
+// histogram of rows per count (histogram has count + 1 slots)
+template <typename T>
+void count_dividing_rows(const std::vector<T>& sfis, const FastDivisor* divisors, uint32_t count, uint8_t* levels,
+                         uint64_t* histogram) {
+    const T* data = sfis.data();
+    for (size_t i = 0; i < sfis.size(); ++i) {
+        const uint32_t level = count_dividing(data[i], divisors, count);
+        levels[i] = static_cast<uint8_t>(level);
+        ++histogram[level];
+    }
+}
+
+#endif // SFI_COLUMN_H
@@ -0,0 +1,73 @@
+#include "sfi_dictionary.h"
+#include <stdexcept>
+
+void SfiDictionary::clear() {
+    sfis_.clear();
+    groups_.clear();
+    codes_.clear();
+    free_codes_.clear();
+    row_codes_.clear();
+    row_positions_.clear();
+}
+
+void SfiDictionary::reserve(size_t rows) {
+    row_codes_.reserve(rows);
+    row_positions_.reserve(rows);
+}
+
+uint32_t SfiDictionary::code_for(uint64_t sfi) {
+    auto it = codes_.find(sfi);
+    if (it != codes_.end()) return it->second;
+
+    uint32_t code;
+    if (!free_codes_.empty()) {
+        code = free_codes_.back();
+        free_codes_.pop_back();
+        sfis_[code] = sfi;
+    } else {
+        code = static_cast<uint32_t>(sfis_.size());
+        sfis_.push_back(sfi);
+        groups_.emplace_back();
+    }
+    codes_.emplace(sfi, code);
+    return code;
+}
+
+void SfiDictionary::unlink(uint32_t ordinal) {
+    const uint32_t code = row_codes_[ordinal];
+    if (code == kNoCode) return;
+
+    // Swap-remove: the group's last row takes this row's slot
+    auto& group = groups_[code];
+    const uint32_t position = row_positions_[ordinal];
+    const uint32_t moved = group.back();
+    group[position] = moved;
+    row_positions_[moved] = position;
+    group.pop_back();
+
+    if (group.empty()) {
+        codes_.erase(sfis_[code]);
+        sfis_[code] = 0; // 0 is divisible by every query; harmless only because the empty group is never expanded
+        free_codes_.push_back(code);
+    }
+    row_codes_[ordinal] = kNoCode;
+}
+
+void SfiDictionary::assign(uint32_t ordinal, uint64_t sfi) {
+    if (ordinal == row_codes_.size()) {
+        row_codes_.push_back(kNoCode);
+        row_positions_.push_back(0);
+    } else if (ordinal > row_codes_.size()) {
+        throw std::out_of_range("SfiDictionary::assign: ordinals must be dense.");
+    } else {
+        const uint32_t current = row_codes_[ordinal];
+        if (current != kNoCode && sfis_[current] == sfi) return; // Unchanged
+        unlink(ordinal);
+    }
+    if (sfi == 0) return; // Tombstone
+
+    const uint32_t code = code_for(sfi);
+    row_codes_[ordinal] = code;
+    row_positions_[ordinal] = static_cast<uint32_t>(groups_[code].size());
+    groups_[code].push_back(ordinal);
+}
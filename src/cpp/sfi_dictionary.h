@@ -0,0 +1,54 @@
+#ifndef SFI_DICTIONARY_H
+#define SFI_DICTIONARY_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+// Dictionary encoding of a segment's SFI column.
+//
+// Catalogs repeat the same attribute combinations over and over (a few
+// thousand distinct SFIs across tens of thousands of SKUs), so each distinct
+// SFI gets a code and a list of the ordinals that carry it. A filter can then
+// test divisibility once per code and expand only the matching groups.
+//
+// Every row also records its code and its position inside that code's list,
+// so moving a row between groups is a swap-remove plus a push: O(1). Group
+// lists are therefore unordered after updates. Codes whose group empties are
+// recycled for the next new SFI. Tombstoned rows (SFI 0) belong to no group.
+class SfiDictionary {
+public:
+    static constexpr uint32_t kNoCode = UINT32_MAX;
+
+    void clear();
+    void reserve(size_t rows);
+
+    // Sets the SFI of a row. Ordinals must be assigned densely: either an
+    // existing row, or the next one (ordinal == row_count()). SFI 0 unlinks it.
+    void assign(uint32_t ordinal, uint64_t sfi);
+
+    // Codes in use, including recycled ones waiting for reuse (their groups are empty)
+    size_t code_count() const { return sfis_.size(); }
+    // Codes with at least one live row
+    size_t distinct_count() const { return sfis_.size() - free_codes_.size(); }
+    size_t row_count() const { return row_codes_.size(); }
+
+    uint64_t sfi(uint32_t code) const { return sfis_[code]; }
+    const std::vector<uint32_t>& ordinals(uint32_t code) const { return groups_[code]; }
+    uint32_t code_of(uint32_t ordinal) const { return row_codes_[ordinal]; }
+
+private:
+    void unlink(uint32_t ordinal);
+    uint32_t code_for(uint64_t sfi);
+
+    std::vector<uint64_t> sfis_;                  // code -> SFI
+    std::vector<std::vector<uint32_t>> groups_;   // code -> ordinals carrying it (unordered)
+    std::unordered_map<uint64_t, uint32_t> codes_; // SFI -> code (live codes only)
+    std::vector<uint32_t> free_codes_;            // Codes whose group emptied
+
+    std::vector<uint32_t> row_codes_;             // ordinal -> code, kNoCode for tombstones
+    std::vector<uint32_t> row_positions_;         // ordinal -> index in groups_[code]
+};
+
+#endif // SFI_DICTIONARY_H
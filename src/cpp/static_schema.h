@@ -0,0 +1,177 @@
+#ifndef STATIC_SCHEMA_H
+#define STATIC_SCHEMA_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+// Compile-time specialised encoding for catalogs whose attribute vocabulary
+// (attribute names and the values each can take) is known at build time.
+//
+// A vocabulary is a struct generated by primekit_schema_gen from a
+// primes.json (see src/cpp/schemas/). It lists the names together with a
+// hash seed and per-attribute table sizes the generator found to be
+// collision-free, and StaticLookup builds constexpr perfect-hash tables from
+// them: a lookup hashes a few bytes of the name, reads one table entry and
+// confirms with one string compare. Primes are not part of the vocabulary:
+// brands sharing it use different primes, so StaticEncoder binds a loaded
+// prime map to the value indexes at runtime and then encodes with a flat
+// array lookup.
+//
+// Schemas that don't match any compiled-in vocabulary keep using the
+// runtime PrimeHashMap, which has the same attribute_slot()/prime() shape.
+
+constexpr uint32_t kStaticNoSlot = UINT32_MAX;
+constexpr uint32_t kStaticNoValue = UINT32_MAX;
+
+// FNV-1a over every byte of the name
+constexpr uint64_t static_schema_hash(std::string_view text) {
+    uint64_t h = 14695981039346656037ull;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Table key of a name. By default only the length and the first, middle and
+// last bytes are read, which tells typical attribute values apart in a few
+// instructions; vocabularies where no seed separates those samples set
+// full_hash and pay for a hash over the whole name.
+constexpr uint32_t static_schema_key(std::string_view text, uint32_t seed, bool full_hash) {
+    uint32_t sample = 0;
+    if (full_hash) {
+        const uint64_t h = static_schema_hash(text);
+        sample = static_cast<uint32_t>(h ^ (h >> 32));
+    } else if (!text.empty()) {
+        sample = uint32_t(static_cast<unsigned char>(text[0])) |
+                 uint32_t(static_cast<unsigned char>(text[text.size() / 2])) << 8 |
+                 uint32_t(static_cast<unsigned char>(text[text.size() - 1])) << 16 |
+                 uint32_t(text.size()) << 24;
+    }
+    const uint32_t h = (sample ^ seed) * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+// One vocabulary value: its attribute slot and name
+struct StaticValue {
+    uint32_t slot;
+    std::string_view value;
+};
+
+// Perfect-hash tables for a vocabulary, built at compile time. Vocabulary provides:
+//   kAttributeCount, kValueCount, kAttributes (names by slot),
+//   kValues (StaticValue by index), kSeed, kFullHash,
+//   kAttributeTableBits and kValueTableBits (log2 table size, per slot).
+template <typename Vocabulary>
+struct StaticLookup {
+    static constexpr uint32_t key(std::string_view text) {
+        return static_schema_key(text, Vocabulary::kSeed, Vocabulary::kFullHash);
+    }
+
+    // Start of each slot's range in kValueTable; the last entry is the total size
+    static constexpr std::array<uint32_t, Vocabulary::kAttributeCount + 1> value_offsets() {
+        std::array<uint32_t, Vocabulary::kAttributeCount + 1> offsets{};
+        for (uint32_t slot = 0; slot < Vocabulary::kAttributeCount; ++slot) {
+            offsets[slot + 1] = offsets[slot] + (uint32_t(1) << Vocabulary::kValueTableBits[slot]);
+        }
+        return offsets;
+    }
+    static constexpr auto kValueOffsets = value_offsets();
+
+    static constexpr std::array<uint32_t, (size_t(1) << Vocabulary::kAttributeTableBits)> attribute_table() {
+        std::array<uint32_t, (size_t(1) << Vocabulary::kAttributeTableBits)> table{};
+        for (auto& entry : table) entry = kStaticNoSlot;
+        for (uint32_t slot = 0; slot < Vocabulary::kAttributeCount; ++slot) {
+            table[key(Vocabulary::kAttributes[slot]) & (table.size() - 1)] = slot;
+        }
+        return table;
+    }
+    static constexpr auto kAttributeTable = attribute_table();
+
+    static constexpr std::array<uint32_t, kValueOffsets[Vocabulary::kAttributeCount]> value_table() {
+        std::array<uint32_t, kValueOffsets[Vocabulary::kAttributeCount]> table{};
+        for (auto& entry : table) entry = kStaticNoValue;
+        for (uint32_t index = 0; index < Vocabulary::kValueCount; ++index) {
+            const StaticValue& entry = Vocabulary::kValues[index];
+            const uint32_t mask = (uint32_t(1) << Vocabulary::kValueTableBits[entry.slot]) - 1;
+            table[kValueOffsets[entry.slot] + (key(entry.value) & mask)] = index;
+        }
+        return table;
+    }
+    static constexpr auto kValueTable = value_table();
+
+    static constexpr uint32_t attribute_slot(std::string_view attribute) {
+        const uint32_t slot = kAttributeTable[key(attribute) & (kAttributeTable.size() - 1)];
+        return slot != kStaticNoSlot && Vocabulary::kAttributes[slot] == attribute ? slot : kStaticNoSlot;
+    }
+    // `slot` must be a valid slot (from attribute_slot())
+    static constexpr uint32_t value_index(uint32_t slot, std::string_view value) {
+        const uint32_t mask = (uint32_t(1) << Vocabulary::kValueTableBits[slot]) - 1;
+        const uint32_t index = kValueTable[kValueOffsets[slot] + (key(value) & mask)];
+        return index != kStaticNoValue && Vocabulary::kValues[index].value == value ? index : kStaticNoValue;
+    }
+
+    // True when every name maps back to itself, i.e. no two names share a
+    // table entry (generated headers static_assert this)
+    static constexpr bool consistent() {
+        for (uint32_t slot = 0; slot < Vocabulary::kAttributeCount; ++slot) {
+            if (attribute_slot(Vocabulary::kAttributes[slot]) != slot) return false;
+        }
+        for (uint32_t index = 0; index < Vocabulary::kValueCount; ++index) {
+            const StaticValue& entry = Vocabulary::kValues[index];
+            if (value_index(entry.slot, entry.value) != index) return false;
+        }
+        return true;
+    }
+};
+
+// Encoder for one vocabulary, bound to one primes.json
+template <typename Vocabulary>
+class StaticEncoder {
+public:
+    using Lookup = StaticLookup<Vocabulary>;
+    static constexpr uint32_t kNoSlot = kStaticNoSlot;
+
+    // Takes the primes for every vocabulary value from the loaded map. Fails
+    // (the caller falls back to the runtime map) when the map has an attribute
+    // or value the vocabulary lacks. Values it leaves out get prime 1 and are
+    // treated as unknown, as the runtime map would.
+    bool bind(const std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>>& prime_map) {
+        primes_.fill(1);
+        for (const auto& [attribute, values] : prime_map) {
+            const uint32_t slot = Lookup::attribute_slot(attribute);
+            if (slot == kStaticNoSlot) {
+                if (values.empty()) continue;
+                return false;
+            }
+            for (const auto& [value, prime] : values) {
+                const uint32_t index = Lookup::value_index(slot, value);
+                if (index == kStaticNoValue) return false;
+                primes_[index] = prime;
+            }
+        }
+        return true;
+    }
+
+    static constexpr uint32_t slot_count() { return Vocabulary::kAttributeCount; }
+    uint32_t attribute_slot(std::string_view attribute) const { return Lookup::attribute_slot(attribute); }
+    // Prime of a value under the attribute in `slot`, 1 if unknown (neutral in an SFI)
+    uint64_t prime(uint32_t slot, std::string_view value) const {
+        if (slot >= Vocabulary::kAttributeCount) return 1;
+        const uint32_t index = Lookup::value_index(slot, value);
+        return index == kStaticNoValue ? 1 : primes_[index];
+    }
+    uint64_t prime(std::string_view attribute, std::string_view value) const {
+        const uint32_t slot = attribute_slot(attribute);
+        return slot == kNoSlot ? 1 : prime(slot, value);
+    }
+
+private:
+    std::array<uint64_t, Vocabulary::kValueCount> primes_{};
+};
+
+#endif // STATIC_SCHEMA_H
@@ -0,0 +1,328 @@
+// primekit_tests: engine checks run by ctest (ctest --test-dir <build>).
+//
+// Each check builds a small catalog in memory and compares the engine with a
+// model kept by the test: a map of id -> SFI, matched by plain divisibility.
+// Covers the guarantees callers rely on that no single query shows:
+//   - applyDelta is all-or-nothing: a delta rejected partway leaves the rows
+//     and the segment version (so cached results and page cursors) as they were
+//   - query_page cursors page through exactly perform_filter's result and are
+//     rejected once stale, foreign or malformed
+//   - upsert_sku/remove_sku, including the automatic compaction a long run of
+//     removals triggers, keep perform_filter equal to the model
+// Runs every check and exits non-zero if any failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "primekit.h"
+#include "log.h"
+#include "result_buffer.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+template <typename Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// --- Test Catalog ---
+
+// Small apparel schema plus "tag", whose primes are large enough that four
+// tags overflow a 64-bit SFI
+const char* kPrimesJson = R"({"attribute_to_prime": {
+    "color": {"Red": 2, "Blue": 3, "Green": 5, "Yellow": 7},
+    "size": {"S": 11, "M": 13, "L": 17},
+    "material": {"Cotton": 19, "Wool": 23, "Silk": 29},
+    "tag": {"a": 1048583, "b": 1048589, "c": 1048601, "d": 1048609}
+}})";
+
+const std::vector<std::pair<std::string, std::vector<std::pair<std::string, uint64_t>>>>& schema() {
+    static const std::vector<std::pair<std::string, std::vector<std::pair<std::string, uint64_t>>>> attributes = {
+        {"color", {{"Red", 2}, {"Blue", 3}, {"Green", 5}, {"Yellow", 7}}},
+        {"size", {{"S", 11}, {"M", 13}, {"L", 17}}},
+        {"material", {{"Cotton", 19}, {"Wool", 23}, {"Silk", 29}}},
+    };
+    return attributes;
+}
+
+std::string sku_id(uint32_t i) {
+    char id[16];
+    std::snprintf(id, sizeof(id), "SKU%05u", i);
+    return id;
+}
+
+// Deterministic attributes for the i-th SKU: one color, one size, zero to two materials
+ItemAttributes sku_attributes(uint32_t i) {
+    const auto& attributes = schema();
+    uint32_t h = i * 2654435761u;
+    ItemAttributes result;
+    result["color"] = {attributes[0].second[h % 4].first};
+    result["size"] = {attributes[1].second[(h >> 4) % 3].first};
+    const uint32_t material_count = (h >> 8) % 3;
+    for (uint32_t m = 0; m < material_count; ++m) {
+        result["material"].push_back(attributes[2].second[((h >> 12) + m) % 3].first);
+    }
+    return result;
+}
+
+uint64_t model_sfi(const ItemAttributes& item) {
+    uint64_t sfi = 1;
+    for (const auto& [key, values] : schema()) {
+        auto it = item.find(key);
+        if (it == item.end()) continue;
+        for (const auto& [value, prime] : values) {
+            for (const std::string& v : it->second) {
+                if (v == value) sfi *= prime;
+            }
+        }
+    }
+    return sfi;
+}
+
+std::string inventory_json(uint32_t count) {
+    std::string json = "[";
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i) json += ",";
+        json += "{\"id\":\"" + sku_id(i) + "\",\"attributes\":{";
+        bool first_key = true;
+        for (const auto& [key, values] : sku_attributes(i)) {
+            if (!first_key) json += ",";
+            first_key = false;
+            json += "\"" + key + "\":[";
+            for (size_t v = 0; v < values.size(); ++v) json += (v ? ",\"" : "\"") + values[v] + "\"";
+            json += "]";
+        }
+        json += "}}";
+    }
+    return json + "]";
+}
+
+// Catalog order of the model: load order, then upserted ids in insertion order
+struct Model {
+    std::vector<std::string> order;
+    std::map<std::string, uint64_t> sfis; // Live rows only
+
+    void upsert(const std::string& id, uint64_t sfi) {
+        if (!sfis.count(id)) order.push_back(id);
+        sfis[id] = sfi;
+    }
+    void remove(const std::string& id) {
+        sfis.erase(id);
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (order[i] == id) {
+                order.erase(order.begin() + i);
+                break;
+            }
+        }
+    }
+    std::vector<std::string> matches(uint64_t query_sfi) const {
+        std::vector<std::string> ids;
+        for (const std::string& id : order) {
+            if (sfis.at(id) % query_sfi == 0) ids.push_back(id);
+        }
+        return ids;
+    }
+};
+
+Model load(PrimeKit& kit, uint32_t count) {
+    kit.initializePrimesFromJson(kPrimesJson);
+    kit.initializeFromJson(inventory_json(count));
+    Model model;
+    for (uint32_t i = 0; i < count; ++i) model.upsert(sku_id(i), model_sfi(sku_attributes(i)));
+    return model;
+}
+
+// Single primes, pairs across attributes and a few triples
+std::vector<uint64_t> test_queries() {
+    std::vector<uint64_t> queries = {1, 2 * 3, 31};
+    const auto& attributes = schema();
+    for (const auto& [key, values] : attributes) {
+        for (const auto& [value, prime] : values) queries.push_back(prime);
+    }
+    for (const auto& [color, color_prime] : attributes[0].second) {
+        for (const auto& [size, size_prime] : attributes[1].second) {
+            queries.push_back(color_prime * size_prime);
+            queries.push_back(color_prime * size_prime * 23);
+        }
+    }
+    return queries;
+}
+
+bool filter_matches_model(PrimeKit& kit, const Model& model) {
+    for (uint64_t query_sfi : test_queries()) {
+        const std::vector<FilterResult> results = kit.perform_filter(query_sfi);
+        const std::vector<std::string> expected = model.matches(query_sfi);
+        if (results.size() != expected.size()) return false;
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (results[i].id != expected[i] || results[i].sfi != model.sfis.at(expected[i])) return false;
+        }
+    }
+    return kit.sku_count() == model.sfis.size();
+}
+
+// --- Checks ---
+
+void test_rejected_delta_changes_nothing() {
+    PrimeKit kit;
+    Model model = load(kit, 500);
+    ResultBuffer page;
+    const std::string cursor = kit.query_page(2, "", 10, page).next_cursor;
+    kit.perform_filter(3); // Cached under the current version
+
+    // The remove, the first add and the update are valid; the second add overflows
+    const std::string delta = R"({"format": "primekit-delta", "version": 1,
+        "remove": ["SKU00000"],
+        "add": [{"id": "NEW1", "attributes": {"size": ["M"]}},
+                {"id": "NEW2", "attributes": {"color": ["Red"], "tag": ["a", "b", "c", "d"]}}],
+        "update": [{"id": "SKU00001", "attributes": {"color": ["Blue"]}}]})";
+    CHECK(throws([&] { kit.applyDelta(delta); }));
+    CHECK(filter_matches_model(kit, model));
+
+    // Same version: the cached result still answers, and the cursor keeps paging
+    const uint64_t cache_hits = kit.get_stats().cache_hits;
+    kit.perform_filter(3);
+    CHECK(kit.get_stats().cache_hits == cache_hits + 1);
+    CHECK(!throws([&] { kit.query_page(2, cursor, 10, page); }));
+
+    // The same delta without the overflowing entry applies in full
+    const std::string valid = R"({"format": "primekit-delta", "version": 1,
+        "remove": ["SKU00000"],
+        "add": [{"id": "NEW1", "attributes": {"size": ["M"]}}],
+        "update": [{"id": "SKU00001", "attributes": {"color": ["Blue"]}}]})";
+    CHECK(kit.applyDelta(valid) == 3);
+    model.remove("SKU00000");
+    model.upsert("NEW1", 13);
+    ItemAttributes updated = sku_attributes(1);
+    updated["color"] = {"Blue"};
+    model.upsert("SKU00001", model_sfi(updated));
+    CHECK(filter_matches_model(kit, model));
+}
+
+void check_paging(PrimeKit& kit, const Model& model) {
+    ResultBuffer page;
+    for (uint64_t query_sfi : test_queries()) {
+        const std::vector<std::string> expected = model.matches(query_sfi);
+        std::vector<std::string> paged;
+        std::string cursor;
+        do {
+            const QueryPage result = kit.query_page(query_sfi, cursor, 7, page);
+            CHECK(result.total == expected.size());
+            for (size_t i = 0; i < page.size(); ++i) paged.emplace_back(page.id(i));
+            cursor = result.next_cursor;
+        } while (!cursor.empty());
+        CHECK(paged == expected);
+    }
+}
+
+void test_page_cursors() {
+    for (bool cluster : {false, true}) {
+        PrimeKit kit;
+        kit.set_cluster_on_load(cluster);
+        Model model = load(kit, 700);
+        check_paging(kit, model);
+        kit.set_result_cache_bytes(0);
+        check_paging(kit, model);
+
+        ResultBuffer page;
+        const std::string cursor = kit.query_page(2, "", 5, page).next_cursor;
+        CHECK(!cursor.empty());
+        CHECK(throws([&] { kit.query_page(3, cursor, 5, page); }));       // Another query's cursor
+        CHECK(throws([&] { kit.query_page(2, "p1.zz", 5, page); }));      // Malformed
+        CHECK(throws([&] { kit.query_page(2, "bogus", 5, page); }));
+
+        // In-place updates keep the cursor; a compaction renumbers rows and makes it stale
+        kit.upsert_sku("SKU00003", {{"color", {"Red"}}});
+        model.upsert("SKU00003", 2);
+        CHECK(!throws([&] { kit.query_page(2, cursor, 5, page); }));
+        CHECK(kit.remove_sku("SKU00004"));
+        model.remove("SKU00004");
+        kit.compact();
+        CHECK(throws([&] { kit.query_page(2, cursor, 5, page); }));
+        check_paging(kit, model);
+    }
+}
+
+void test_updates_and_auto_compaction() {
+    PrimeKit kit;
+    const uint32_t count = 3000;
+    Model model = load(kit, count);
+    CHECK(filter_matches_model(kit, model));
+    ResultBuffer page;
+    const std::string cursor = kit.query_page(1, "", 5, page).next_cursor;
+
+    // Re-encode some rows in place and append new ones
+    for (uint32_t i = 0; i < count; i += 7) {
+        ItemAttributes item = sku_attributes(i + 1);
+        kit.upsert_sku(sku_id(i), item);
+        model.upsert(sku_id(i), model_sfi(item));
+    }
+    for (uint32_t i = count; i < count + 200; ++i) {
+        kit.upsert_sku(sku_id(i), sku_attributes(i));
+        model.upsert(sku_id(i), model_sfi(sku_attributes(i)));
+    }
+    CHECK(filter_matches_model(kit, model));
+
+    // Unknown ids change nothing, so cached results stay valid
+    kit.perform_filter(2);
+    CHECK(!kit.remove_sku("NOPE"));
+    const uint64_t cache_hits = kit.get_stats().cache_hits;
+    kit.perform_filter(2);
+    CHECK(kit.get_stats().cache_hits == cache_hits + 1);
+    CHECK(!throws([&] { kit.query_page(1, cursor, 5, page); }));
+
+    // Removing well over half the rows crosses the automatic compaction threshold
+    CHECK(count / 2 + 200 >= PrimeKit::kAutoCompactTombstones);
+    for (uint32_t i = 0; i < count + 200; i += 2) {
+        CHECK(kit.remove_sku(sku_id(i)));
+        model.remove(sku_id(i));
+        if (i % 400 == 0) CHECK(filter_matches_model(kit, model));
+    }
+    for (uint32_t i = 1; i < 1200; i += 2) {
+        CHECK(kit.remove_sku(sku_id(i)));
+        model.remove(sku_id(i));
+    }
+    CHECK(filter_matches_model(kit, model));
+    CHECK(throws([&] { kit.query_page(1, cursor, 5, page); })); // Rows were renumbered
+    CHECK(!kit.remove_sku(sku_id(0)));                          // Already removed
+
+    // The compacted segment keeps taking updates
+    for (uint32_t i = 0; i < 300; i += 2) {
+        kit.upsert_sku(sku_id(i), sku_attributes(i + 3));
+        model.upsert(sku_id(i), model_sfi(sku_attributes(i + 3)));
+    }
+    CHECK(filter_matches_model(kit, model));
+    check_paging(kit, model);
+}
+
+} // namespace
+
+int main() {
+    pk_set_log_level(PK_LOG_LEVEL_ERROR); // Loads and unknown-id updates would print at INFO/WARN
+    test_rejected_delta_changes_nothing();
+    test_page_cursors();
+    test_updates_and_auto_compaction();
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("all checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+// primekit_cli: loads a segment natively and runs a query file against it.
+//
+// Usage: primekit_cli <primes.json> <inventory.json> <queries.txt|-> [--repeat N] [--quiet] [--cluster] [--no-cache] [--explain]
+//
+// Query file: one query per line, blank lines and '#' comments ignored.
+// A line is either a raw query SFI ("89", "1") or attribute selections
+// ("color=Red material=Silk"); values with spaces can be quoted
+// ("material='Spandex Blend'"). Unknown values are reported and ignored.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "primekit.h"
+
+using Clock = std::chrono::steady_clock;
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+static double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// Splits "color=Red material='Spandex Blend'" into attr=value tokens
+static std::vector<std::string> tokenize(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::string current;
+    char quote = 0;
+    for (char c : line) {
+        if (quote) {
+            if (c == quote) quote = 0; else current += c;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == ' ' || c == '\t') {
+            if (!current.empty()) tokens.push_back(std::move(current));
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) tokens.push_back(std::move(current));
+    return tokens;
+}
+
+struct Query {
+    std::string text;
+    uint64_t sfi = 1;
+};
+
+static bool compile_query(const PrimeKit& kit, const std::string& line, Query& query) {
+    query.text = line;
+    query.sfi = 1;
+    if (line.find('=') == std::string::npos) {
+        char* end = nullptr;
+        query.sfi = std::strtoull(line.c_str(), &end, 10);
+        return end && *end == '\0' && query.sfi != 0;
+    }
+    for (const std::string& token : tokenize(line)) {
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) return false;
+        uint64_t prime = kit.prime_for(token.substr(0, eq), token.substr(eq + 1));
+        if (prime <= 1) {
+            std::cerr << "Warning: unknown value '" << token << "' ignored in query: " << line << std::endl;
+            continue;
+        }
+        if (query.sfi > UINT64_MAX / prime) {
+            std::cerr << "Warning: query SFI overflows 64 bits, skipping: " << line << std::endl;
+            return false;
+        }
+        query.sfi *= prime;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <primes.json> <inventory.json> <queries.txt|-> [--repeat N] [--quiet] [--cluster] [--no-cache] [--explain]" << std::endl;
+        return 2;
+    }
+    int repeat = 1;
+    bool quiet = false;
+    bool cluster = false;
+    bool no_cache = false; // Repeats are otherwise answered from the result cache
+    bool explain = false;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--cluster") {
+            cluster = true;
+        } else if (arg == "--no-cache") {
+            no_cache = true;
+        } else if (arg == "--explain") {
+            explain = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        PrimeKit kit;
+        kit.set_cluster_on_load(cluster);
+        if (no_cache) kit.set_result_cache_bytes(0);
+
+        std::string primes_json = read_file(argv[1]);
+        std::string inventory_json = read_file(argv[2]);
+
+        auto load_start = Clock::now();
+        kit.initializePrimesFromJson(primes_json);
+        kit.initializeFromJson(inventory_json);
+        double load_ms = elapsed_ms(load_start);
+        const size_t sku_count = kit.sku_count();
+
+        std::cout << "Loaded " << sku_count << " SKUs in " << load_ms << " ms ("
+                  << (inventory_json.size() / 1e6) / (load_ms / 1e3) << " MB/s)" << std::endl;
+        const EngineStats load_stats = kit.get_stats();
+        std::cout << "  parse+encode " << load_stats.last_parse_ms << " ms, index " << load_stats.last_encode_ms
+                  << " ms; dropped " << load_stats.last_overflowed_skus << " overflowed / "
+                  << load_stats.last_invalid_items << " invalid, " << load_stats.last_missing_prime_values
+                  << " values without a prime" << std::endl;
+
+        // --- Read and compile queries ---
+        std::vector<Query> queries;
+        {
+            std::string query_path = argv[3];
+            std::ifstream file;
+            if (query_path != "-") {
+                file.open(query_path);
+                if (!file) throw std::runtime_error("Cannot open " + query_path);
+            }
+            std::istream& in = query_path == "-" ? std::cin : file;
+            std::string line;
+            while (std::getline(in, line)) {
+                size_t first = line.find_first_not_of(" \t\r");
+                if (first == std::string::npos || line[first] == '#') continue;
+                size_t last = line.find_last_not_of(" \t\r");
+                line = line.substr(first, last - first + 1);
+                Query query;
+                if (compile_query(kit, line, query)) {
+                    queries.push_back(query);
+                } else {
+                    std::cerr << "Warning: skipping malformed query: " << line << std::endl;
+                }
+            }
+        }
+        if (queries.empty()) {
+            std::cerr << "No queries to run." << std::endl;
+            return 1;
+        }
+
+        // --- Run ---
+        std::vector<size_t> match_counts(queries.size(), 0);
+        ResultBuffer results; // Reused by every query, as the web client does
+        auto run_start = Clock::now();
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t q = 0; q < queries.size(); ++q) {
+                kit.perform_filter_into(queries[q].sfi, results);
+                match_counts[q] = results.size();
+            }
+        }
+        double run_ms = elapsed_ms(run_start);
+
+        if (!quiet) {
+            for (size_t q = 0; q < queries.size(); ++q) {
+                std::cout << match_counts[q] << "\t" << queries[q].sfi << "\t" << queries[q].text << std::endl;
+            }
+        }
+
+        const double executed = static_cast<double>(queries.size()) * repeat;
+        std::cout << "Ran " << executed << " queries in " << run_ms << " ms: "
+                  << executed / (run_ms / 1e3) << " queries/s, "
+                  << (executed * sku_count) / (run_ms / 1e3) / 1e6 << " M SKUs/s, "
+                  << (run_ms * 1e6) / (executed * std::max<size_t>(sku_count, 1)) << " ns/SKU" << std::endl;
+        const EngineStats run_stats = kit.get_stats();
+        std::cout << "  scan " << run_stats.total_scan_ms << " ms, materialize " << run_stats.total_materialize_ms
+                  << " ms, " << run_stats.total_matches << " matches, " << run_stats.cache_hits << " cache hits, "
+                  << run_stats.total_allocations << " allocations" << std::endl;
+
+        if (explain) {
+            std::cout << "plan\testimated\tactual\tms\tscan/dictionary/postings cost\tquery" << std::endl;
+            for (const Query& query : queries) {
+                const QueryPlan plan = kit.explain(query.sfi);
+                std::cout << plan.strategy << "(" << plan.column << ")\t" << plan.estimated_rows << "\t" << plan.actual_rows << "\t"
+                          << plan.elapsed_ms << "\t" << plan.scan_cost << "/" << plan.dictionary_cost << "/"
+                          << plan.postings_cost << "\t" << query.text << std::endl;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
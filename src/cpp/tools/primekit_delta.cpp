@@ -0,0 +1,123 @@
+// primekit_delta: diffs two inventory snapshots into a PrimeKit delta patch.
+//
+// Usage: primekit_delta <old_inventory.json> <new_inventory.json> [out_delta.json]
+//
+// Output format (consumed by PrimeKit::applyDelta):
+//   {"format": "primekit-delta", "version": 1,
+//    "remove": ["SKU1", ...],                                   // ids gone from the new snapshot
+//    "add":    [{"id": "SKU2", "attributes": {...}}, ...],      // ids new in the new snapshot
+//    "update": [{"id": "SKU3", "attributes": {"size": ["M"]}}]} // changed attribute keys only
+// An attribute key dropped from a SKU is written as an empty list so the
+// patch clears it. Fields other than "attributes" (e.g. "name") do not affect
+// SFIs and are not diffed.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+static json load_inventory(const char* path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(std::string("Cannot open ") + path);
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    json inventory = json::parse(buffer.str());
+    if (!inventory.is_array()) {
+        throw std::runtime_error(std::string(path) + " is not an inventory array");
+    }
+    return inventory;
+}
+
+// id -> attributes object for every well-formed item
+static std::unordered_map<std::string, const json*> index_by_id(const json& inventory) {
+    std::unordered_map<std::string, const json*> index;
+    index.reserve(inventory.size());
+    for (const auto& item : inventory) {
+        if (!item.is_object() || !item.contains("id") || !item["id"].is_string()) continue;
+        static const json empty = json::object();
+        const json* attributes = item.contains("attributes") ? &item["attributes"] : &empty;
+        index[item["id"].get<std::string>()] = attributes;
+    }
+    return index;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <old_inventory.json> <new_inventory.json> [out_delta.json]" << std::endl;
+        return 2;
+    }
+
+    try {
+        json old_inventory = load_inventory(argv[1]);
+        json new_inventory = load_inventory(argv[2]);
+        auto old_index = index_by_id(old_inventory);
+        auto new_index = index_by_id(new_inventory);
+
+        json removed = json::array();
+        json added = json::array();
+        json updated = json::array();
+
+        // Walk the snapshots in file order so the patch is deterministic
+        for (const auto& item : old_inventory) {
+            if (!item.is_object() || !item.contains("id") || !item["id"].is_string()) continue;
+            const std::string id = item["id"].get<std::string>();
+            if (!new_index.count(id)) removed.push_back(id);
+        }
+
+        for (const auto& item : new_inventory) {
+            if (!item.is_object() || !item.contains("id") || !item["id"].is_string()) continue;
+            const std::string id = item["id"].get<std::string>();
+            const json& new_attributes = *new_index.at(id);
+
+            auto old_it = old_index.find(id);
+            if (old_it == old_index.end()) {
+                added.push_back({{"id", id}, {"attributes", new_attributes}});
+                continue;
+            }
+
+            const json& old_attributes = *old_it->second;
+            json changed = json::object();
+            for (auto const& [attr_key, values] : new_attributes.items()) {
+                if (!old_attributes.contains(attr_key) || old_attributes[attr_key] != values) {
+                    changed[attr_key] = values;
+                }
+            }
+            for (auto const& [attr_key, values] : old_attributes.items()) {
+                if (!new_attributes.contains(attr_key)) changed[attr_key] = json::array();
+            }
+            if (!changed.empty()) {
+                updated.push_back({{"id", id}, {"attributes", changed}});
+            }
+        }
+
+        json delta = {
+            {"format", "primekit-delta"},
+            {"version", 1},
+            {"remove", removed},
+            {"add", added},
+            {"update", updated},
+        };
+        const std::string out = delta.dump(); // Compact: the point is a small download
+
+        if (argc == 4) {
+            std::ofstream file(argv[3]);
+            if (!file) throw std::runtime_error(std::string("Cannot write ") + argv[3]);
+            file << out;
+        } else {
+            std::cout << out << std::endl;
+        }
+
+        std::cerr << "Delta: " << removed.size() << " removed, " << added.size() << " added, "
+                  << updated.size() << " updated (" << out.size() << " bytes)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// primekit_gen_cli: writes synthetic brand segments (inventory.json + primes.json).
+//
+// Usage: primekit_gen_cli [options]
+//   --out DIR          output directory, one sub-directory per brand (default: data/segments_gen)
+//   --skus N           total SKUs across all brands (default: 20000)
+//   --brands N         number of brands (default: 3)
+//   --attributes N     number of attributes (default: 3, the apparel schema)
+//   --values N         values per attribute when --attributes is given (default: 12)
+//   --multi R          multi-value rate per attribute when --attributes is given (default: 0.3)
+//   --zipf S           value skew exponent, 0 = uniform (default: 0)
+//   --brand-zipf S     brand skew exponent (default: 0)
+//   --max-values N     max values per attribute on one SKU (default: 2)
+//   --seed N           RNG seed (default: 42)
+//
+// Output is JSON in the layout the web app and PrimeKit::initializeFromJson read.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "gen/catalog_generator.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv) {
+    CatalogConfig config = CatalogConfig::apparel();
+    std::string out_dir = "data/segments_gen";
+    long attribute_count = -1;
+    uint32_t values = 12;
+    double multi = 0.3;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--out") out_dir = next();
+        else if (arg == "--skus") config.sku_count = std::strtoull(next(), nullptr, 10);
+        else if (arg == "--brands") config.brand_count = static_cast<uint32_t>(std::strtoul(next(), nullptr, 10));
+        else if (arg == "--attributes") attribute_count = std::strtol(next(), nullptr, 10);
+        else if (arg == "--values") values = static_cast<uint32_t>(std::strtoul(next(), nullptr, 10));
+        else if (arg == "--multi") multi = std::strtod(next(), nullptr);
+        else if (arg == "--zipf") config.zipf_s = std::strtod(next(), nullptr);
+        else if (arg == "--brand-zipf") config.brand_zipf_s = std::strtod(next(), nullptr);
+        else if (arg == "--max-values") config.max_values_per_attribute = static_cast<uint32_t>(std::strtoul(next(), nullptr, 10));
+        else if (arg == "--seed") config.seed = std::strtoull(next(), nullptr, 10);
+        else {
+            std::cerr << "Unknown option: " << arg << " (see the header of tools/primekit_gen.cpp)" << std::endl;
+            return 2;
+        }
+    }
+    if (attribute_count > 0) {
+        config.attributes = CatalogConfig::make_attributes(static_cast<uint32_t>(attribute_count), values, multi);
+    }
+
+    try {
+        CatalogGenerator generator(config);
+        const auto& brands = generator.brand_names();
+
+        std::vector<std::ofstream> files(brands.size());
+        for (size_t b = 0; b < brands.size(); ++b) {
+            fs::path dir = fs::path(out_dir) / brands[b];
+            fs::create_directories(dir);
+            std::ofstream primes(dir / "primes.json");
+            primes << generator.primes_json(static_cast<uint32_t>(b));
+            files[b].open(dir / "inventory.json", std::ios::binary);
+            if (!files[b]) throw std::runtime_error("Cannot write " + (dir / "inventory.json").string());
+        }
+
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        generator.generate([&](uint32_t brand, const std::string& chunk) {
+            files[brand].write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            bytes += chunk.size();
+        });
+        for (auto& f : files) f.close();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const GeneratorStats& stats = generator.stats();
+        std::cout << "Wrote " << config.sku_count << " SKUs (" << bytes / 1e6 << " MB) to " << out_dir
+                  << " in " << seconds << " s: " << config.sku_count / seconds / 1e6 << " M SKUs/s" << std::endl;
+        for (size_t b = 0; b < brands.size(); ++b) {
+            std::cout << "  " << brands[b] << ": " << stats.skus_per_brand[b] << " SKUs" << std::endl;
+        }
+        std::cout << "  multi-value SKUs: " << stats.multi_value_skus
+                  << ", SFI would overflow 64 bits: " << stats.overflowing_skus << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
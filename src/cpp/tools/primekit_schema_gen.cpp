@@ -0,0 +1,195 @@
+// primekit_schema_gen: emits a compile-time vocabulary header from a primes.json.
+//
+// Usage: primekit_schema_gen <primes.json> <StructName> [out_header.h]
+//
+// The header defines StructName with the vocabulary's names plus a hash seed
+// and power-of-two table sizes under which the attribute names, and the values
+// of each attribute, all land in distinct table entries. StaticLookup (see
+// src/cpp/static_schema.h) builds those perfect-hash tables at compile time.
+// Only names are baked in, not primes: any primes.json with the same
+// attributes and values binds to it at load time. Attributes and values are
+// emitted in name order so the output is stable.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "static_schema.h"
+
+using json = nlohmann::json;
+
+// C++ string literal for arbitrary bytes
+static std::string quote(const std::string& text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+static std::string guard_for(const std::string& name) {
+    std::string guard;
+    for (size_t i = 0; i < name.size(); ++i) {
+        const char c = name[i];
+        if (i > 0 && std::isupper(static_cast<unsigned char>(c)) && std::islower(static_cast<unsigned char>(name[i - 1]))) {
+            guard += '_';
+        }
+        guard += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return guard + "_H";
+}
+
+// log2 of the smallest table (at most 8x the name count) in which every name
+// has its own entry under `seed`, or -1 if there is none
+static int table_bits(const std::vector<std::string>& names, uint32_t seed, bool full_hash) {
+    int bits = 0;
+    while ((size_t(1) << bits) < names.size()) ++bits;
+    for (const int limit = bits + 3; bits <= limit; ++bits) {
+        const uint32_t mask = (uint32_t(1) << bits) - 1;
+        std::set<uint32_t> seen;
+        bool distinct = true;
+        for (const std::string& name : names) {
+            if (!seen.insert(static_schema_key(name, seed, full_hash) & mask).second) {
+                distinct = false;
+                break;
+            }
+        }
+        if (distinct) return bits;
+    }
+    return -1;
+}
+
+struct TableLayout {
+    uint32_t seed = 0;
+    bool full_hash = false;
+    int attribute_bits = 0;
+    std::vector<int> value_bits; // By slot
+    size_t entries = 0;
+};
+
+// Tries seeds with the cheap sampled key first, then with the full hash,
+// keeping the layout with the fewest table entries for the first key kind
+// that works at all
+static TableLayout find_layout(const std::vector<std::string>& attributes,
+                               const std::map<std::string, std::vector<std::string>>& vocabulary) {
+    for (const bool full_hash : {false, true}) {
+        TableLayout best;
+        bool found = false;
+        for (uint32_t seed = 0; seed < 1024; ++seed) {
+            TableLayout layout;
+            layout.seed = seed;
+            layout.full_hash = full_hash;
+            layout.attribute_bits = table_bits(attributes, seed, full_hash);
+            bool ok = layout.attribute_bits >= 0;
+            for (size_t slot = 0; ok && slot < attributes.size(); ++slot) {
+                const int bits = table_bits(vocabulary.at(attributes[slot]), seed, full_hash);
+                ok = bits >= 0;
+                layout.value_bits.push_back(bits);
+                layout.entries += size_t(1) << std::max(bits, 0);
+            }
+            if (ok && (!found || layout.entries < best.entries)) {
+                best = layout;
+                found = true;
+            }
+        }
+        if (found) return best;
+    }
+    throw std::runtime_error("No collision-free hash tables for this vocabulary");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <primes.json> <StructName> [out_header.h]" << std::endl;
+        return 2;
+    }
+    const std::string struct_name = argv[2];
+
+    try {
+        std::ifstream in(argv[1]);
+        if (!in) throw std::runtime_error(std::string("Cannot open ") + argv[1]);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        const json primes_json = json::parse(buffer.str());
+        if (!primes_json.contains("attribute_to_prime") || !primes_json["attribute_to_prime"].is_object()) {
+            throw std::runtime_error("Invalid primes JSON format: missing 'attribute_to_prime' section.");
+        }
+
+        // attribute -> values, both in name order
+        std::map<std::string, std::vector<std::string>> vocabulary;
+        for (const auto& [attribute, values] : primes_json["attribute_to_prime"].items()) {
+            if (!values.is_object() || values.empty()) continue;
+            auto& names = vocabulary[attribute];
+            for (const auto& [value, prime] : values.items()) names.push_back(value);
+            std::sort(names.begin(), names.end());
+        }
+        std::vector<std::string> attributes;
+        for (const auto& [attribute, values] : vocabulary) attributes.push_back(attribute);
+        const TableLayout layout = find_layout(attributes, vocabulary);
+
+        size_t value_count = 0;
+        for (const auto& [attribute, values] : vocabulary) value_count += values.size();
+
+        std::ostringstream out;
+        const std::string guard = guard_for(struct_name);
+        out << "// Generated by primekit_schema_gen from " << argv[1] << ". Do not edit; regenerate with\n"
+            << "//   primekit_schema_gen <primes.json> " << struct_name << " <this file>\n"
+            << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+            << "#include \"static_schema.h\"\n\n"
+            << "struct " << struct_name << " {\n"
+            << "    static constexpr uint32_t kAttributeCount = " << attributes.size() << ";\n"
+            << "    static constexpr uint32_t kValueCount = " << value_count << ";\n\n"
+            << "    static constexpr std::array<std::string_view, kAttributeCount> kAttributes = {\n";
+        for (const std::string& attribute : attributes) out << "        " << quote(attribute) << ",\n";
+        out << "    };\n\n"
+            << "    static constexpr std::array<StaticValue, kValueCount> kValues = {{\n";
+        for (size_t slot = 0; slot < attributes.size(); ++slot) {
+            for (const std::string& value : vocabulary[attributes[slot]]) {
+                out << "        {" << slot << ", " << quote(value) << "},\n";
+            }
+        }
+        out << "    }};\n\n";
+
+        out << "    static constexpr uint32_t kSeed = " << layout.seed << ";\n"
+            << "    static constexpr bool kFullHash = " << (layout.full_hash ? "true" : "false") << ";\n"
+            << "    static constexpr uint32_t kAttributeTableBits = " << layout.attribute_bits << ";\n"
+            << "    static constexpr std::array<uint32_t, kAttributeCount> kValueTableBits = {";
+        for (size_t slot = 0; slot < attributes.size(); ++slot) {
+            out << (slot ? ", " : "") << layout.value_bits[slot];
+        }
+        out << "};\n"
+            << "};\n\n"
+            << "static_assert(StaticLookup<" << struct_name << ">::consistent(), \"" << struct_name
+            << " hash tables have a collision\");\n\n"
+            << "#endif // " << guard << "\n";
+
+        if (argc == 4) {
+            std::ofstream file(argv[3]);
+            if (!file) throw std::runtime_error(std::string("Cannot write ") + argv[3]);
+            file << out.str();
+        } else {
+            std::cout << out.str();
+        }
+        std::cerr << struct_name << ": " << attributes.size() << " attributes, " << value_count << " values, seed " << layout.seed
+                  << (layout.full_hash ? " (full hash)" : "") << ", " << layout.entries << " value table entries" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#include "zone_map.h"
+
+void ZoneMap::clear() {
+    words_per_block_ = 0;
+    bits_.clear();
+}
+
+void ZoneMap::reset(uint32_t value_count) {
+    bits_.clear();
+    words_per_block_ = (value_count + 63) / 64;
+}
+
+void ZoneMap::mark(uint32_t ordinal, uint32_t value_id) {
+    if (!words_per_block_) return;
+    const size_t block = ordinal / kBlockRows;
+    const size_t needed = (block + 1) * words_per_block_;
+    if (bits_.size() < needed) bits_.resize(needed, 0);
+    bits_[block * words_per_block_ + value_id / 64] |= uint64_t(1) << (value_id % 64);
+}
@@ -0,0 +1,53 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Block-level skip index for the row scan.
+//
+// Rows are grouped into fixed blocks of kBlockRows ordinals. Each block keeps
+// a bitset over value ids (indexes into the schema's PrimeFactorTable
+// entries) with a bit set for every attribute value present in the block. A
+// query that needs "Silk" can skip any block whose Silk bit is clear without
+// reading its SFIs.
+//
+// Bits are only ever added by updates, so a block may claim a value that its
+// rows no longer carry. That only costs a wasted scan, never a missed match.
+// Compaction rebuilds the map exactly.
+class ZoneMap {
+public:
+    static constexpr uint32_t kBlockRows = 2048;
+
+    void clear();
+    // Drops all blocks and sizes the per-block bitset for value_count value ids
+    void reset(uint32_t value_count);
+
+    // Records that the row at `ordinal` carries value id `value_id`; grows the block list as needed
+    void mark(uint32_t ordinal, uint32_t value_id);
+
+    bool enabled() const { return words_per_block_ > 0; }
+    size_t block_count() const { return words_per_block_ ? bits_.size() / words_per_block_ : 0; }
+    uint32_t words_per_block() const { return words_per_block_; }
+
+    // True if every bit of `mask` (words_per_block() words) is set in the block
+    bool may_contain(size_t block, const std::vector<uint64_t>& mask) const {
+        const uint64_t* bits = bits_.data() + block * words_per_block_;
+        for (uint32_t w = 0; w < words_per_block_; ++w) {
+            if ((bits[w] & mask[w]) != mask[w]) return false;
+        }
+        return true;
+    }
+
+    // True if the block's bit for `value_id` is set
+    bool contains(size_t block, uint32_t value_id) const {
+        return (bits_[block * words_per_block_ + value_id / 64] >> (value_id % 64)) & 1;
+    }
+
+private:
+    uint32_t words_per_block_ = 0;
+    std::vector<uint64_t> bits_; // block_count() * words_per_block_ words
+};
+
+#endif // ZONE_MAP_H
@@ -5,6 +5,10 @@ import primekitModuleFactory from '../../build/wasm_build/primekit.js';
 // --- Constants ---
 const FILTER_DEBOUNCE_DELAY = 250; // ms (Keep for potential future use, but not active)
 const CACHE_EXPIRY_MS = 60 * 60 * 1000; // 1 hour cache
+const FILTER_STEP_BUDGET_US = 4000; // WASM work per slice before yielding to input handling
+const PAGE_SIZE = 100; // Rows fetched per page; more are fetched as the list is scrolled
+const SCROLL_FETCH_MARGIN_PX = 400; // Fetch the next page this close to the bottom of the list
+const SIMILAR_COUNT = 10; // "More like this" items listed under a found SKU
 
 // --- DOM Elements ---
 const segmentSelect = document.getElementById('segment-select');
@@ -26,6 +30,12 @@ const applyFilterButton = document.getElementById('apply-filter-button'); // Add
 // --- Global State ---
 let primeKitModule = null;          // Initialized WASM module instance (from factory)
 let primeKitInstance = null;        // Instance of the C++ PrimeKit class for the current segment
+let resultBuffer = null;            // C++ ResultBuffer reused by every filter (results land here, not in a new vector)
+const idDecoder = new TextDecoder();
+let activeCursor = null;            // C++ QueryCursor of the filter being counted, cancelled when superseded
+let currentQueryPrimes = null;      // Uint32Array of the filter being paged through
+let nextPageCursor = '';            // Opaque continuation token from query_page ('' once all pages are shown)
+let isPageLoading = false;
 let currentSegmentId = null;        // e.g., "BrandA"
 let currentPrimesData = null;       // Parsed primes.json { attribute_to_prime: { ... } }
 let currentInventoryData = null;    // Parsed inventory.json for SKU search fallback
@@ -153,11 +163,13 @@ async function loadSegment(segmentId) {
     if (!segmentId) {
         mainContentDiv.style.display = 'none';
         updateStatus("Select a brand segment to begin...");
+        activeCursor?.cancel();
         primeKitInstance?.delete();
         primeKitInstance = null;
         currentInventoryData = null;
         currentPrimesData = null;
         currentMatchingResults = [];
+        nextPageCursor = '';
         resultsListElement.innerHTML = '';
         resultsCountDiv.textContent = 'Total items: 0 | Matching: 0';
         return;
@@ -212,6 +224,7 @@ async function loadSegment(segmentId) {
         updateStatus(`Initializing WASM for ${segmentId}...`);
         if (!primeKitModule) throw new Error("WASM module failed to load.");
 
+        activeCursor?.cancel(); // Cursors must not outlive their kit
         primeKitInstance?.delete(); // Delete previous instance
         primeKitInstance = new primeKitModule.PrimeKit();
         console.log("Created new PrimeKit instance.");
@@ -233,6 +246,7 @@ async function loadSegment(segmentId) {
         updateStatus(`Error loading segment ${segmentId}: ${error.message}`, true);
         console.error(`Error loading segment ${segmentId}:`, error);
         mainContentDiv.style.display = 'none';
+        activeCursor?.cancel();
         primeKitInstance?.delete();
         primeKitInstance = null;
         currentInventoryData = null;
@@ -272,9 +286,38 @@ function handleSkuSearchEnter(e) {
 }
 
 /**
- * Calculates query SFI, calls WASM, sorts by SFI, displays simple results.
+ * Lets the browser handle pending input and rendering before the next slice.
  */
-function handleFilter() {
+function yieldToEventLoop() {
+    return new Promise(resolve => setTimeout(resolve, 0));
+}
+
+/**
+ * Converts the rows of the last query_page call into {id, sfi, ordinal} objects.
+ * Views alias WASM memory and go stale on the next query, so rows are copied out here.
+ */
+function readResultBuffer() {
+    const rows = [];
+    const ordinals = resultBuffer.ordinals();
+    const sfis = resultBuffer.sfis();
+    const idOffsets = resultBuffer.id_offsets();
+    const idBytes = resultBuffer.id_bytes();
+    for (let i = 0; i < ordinals.length; ++i) {
+        rows.push({
+            id: idDecoder.decode(idBytes.subarray(idOffsets[i], idOffsets[i + 1])),
+            sfi: Number(sfis[i]),
+            ordinal: ordinals[i], // ordinal feeds decode_batch
+        });
+    }
+    return rows;
+}
+
+/**
+ * Collects the selected primes, fetches the first page of matches and the
+ * total count, and displays them. Later pages load as the list is scrolled.
+ * The matches are counted in time slices first; a newer call cancels an unfinished count.
+ */
+async function handleFilter() {
     if (!primeKitInstance || !currentInventoryData || !currentPrimesData) {
         updateStatus("Not ready to filter (WASM or data missing).", true);
         return;
@@ -286,94 +329,124 @@ function handleFilter() {
     const startTime = performance.now();
     performance.mark('handleFilter-start');
 
-    // --- Calculate Single Query SFI ---
-    let querySfi = 1n;
+    // --- Collect Selected Primes ---
+    // The engine combines them itself, so no BigInt product (or 64-bit overflow check) is needed here
+    const selectedPrimes = [];
 
-    // Colors 
-    let colorSelected = false;
+    // Colors (an "Any Color" selection has prime 1 and is ignored by the engine)
     colorFilterGroup?.querySelectorAll('input[name="color-filter"]:checked').forEach(cb => {
-        const prime = BigInt(cb.value);
-        if (prime > 1n) {
-            querySfi *= prime;
-            colorSelected = true;
-        } else if (cb.dataset.name === "Any Color") {
-            colorSelected = true; 
-        }
+        selectedPrimes.push(Number(cb.value));
     });
-    if (!colorSelected) { /* Default to 1 */} 
 
     // Size
     if (sizeFilterSelect) {
-        const sizePrime = BigInt(sizeFilterSelect.value);
-        if (sizePrime > 1n) querySfi *= sizePrime;
+        selectedPrimes.push(Number(sizeFilterSelect.value));
     }
 
     // Materials
-    let materialSelected = false;
     materialFilterGroup?.querySelectorAll('input[name="material-filter"]:checked').forEach(cb => {
-        const prime = BigInt(cb.value);
-        if (prime > 1n) {
-            querySfi *= prime;
-            materialSelected = true;
-        } else if (cb.dataset.name === "Any Material") {
-            materialSelected = true;
-        }
+        selectedPrimes.push(Number(cb.value));
     });
-     if (!materialSelected) { /* Default to 1 */}
-
-    // --- Check for Overflow ---
-    const maxUint64 = (1n << 64n) - 1n;
-    if (querySfi > maxUint64) {
-        updateStatus("Error: Filter query SFI exceeds 64-bit limit.", true);
-        console.error("Query SFI overflow:", { querySfi });
-        resultsListElement.textContent = 'Error: Filter query too large.';
-        resultsCountDiv.textContent = `Total items: ${currentSegmentTotalCount} | Matching: Error`;
-        return;
-    }
-    const querySfiNum = Number(querySfi);
+
+    const queryPrimes = Uint32Array.from(selectedPrimes);
 
     // --- Call WASM --- 
-    console.log(`Performing filter: querySfi=${querySfiNum}`);
+    // A cursor counts the matches in slices so a broad query neither blocks input nor
+    // outlives a newer filter. Its page cursor hands that count to the first query_page,
+    // which then only walks as far as the first page. Only that page is materialized.
+    console.log(`Performing filter: primes=[${queryPrimes.join(', ')}]`);
     performance.mark('wasmFilter-start');
-    let wasmResultVector;
-    let results = []; // Array of {id, sfi}
+    let results = []; // Array of {id, sfi, ordinal}, in catalog order
+    let page;
+    activeCursor?.cancel();
+    nextPageCursor = ''; // The previous filter's pages are superseded
+    const cursor = primeKitInstance.start_query_primes(queryPrimes);
+    activeCursor = cursor;
     try {
-        wasmResultVector = primeKitInstance.perform_filter(querySfiNum); // Pass single query SFI
-        for (let i = 0; i < wasmResultVector.size(); ++i) {
-            const res = wasmResultVector.get(i);
-            results.push({ id: res.id, sfi: res.sfi }); // Store id and sfi
+        while (!cursor.step(FILTER_STEP_BUDGET_US)) {
+            resultsCountDiv.textContent = `Total items in segment: ${currentSegmentTotalCount} | ` +
+                `Matching so far: ${cursor.match_count()} (${Math.round(cursor.progress() * 100)}%)`;
+            await yieldToEventLoop();
+            if (cursor.cancelled()) return; // Superseded by a newer filter or segment
         }
+        resultBuffer ??= new primeKitModule.ResultBuffer();
+        page = primeKitInstance.query_page_primes(queryPrimes, cursor.page_cursor(), PAGE_SIZE, resultBuffer);
+        results = readResultBuffer();
     } catch (e) {
         updateStatus(`Error during filtering: ${e.message}`, true);
         console.error("WASM filter error:", e);
         return;
     } finally {
-        wasmResultVector?.delete();
+        if (activeCursor === cursor) activeCursor = null;
+        cursor.delete();
     }
+    currentQueryPrimes = queryPrimes;
+    nextPageCursor = page.next_cursor;
     performance.mark('wasmFilter-end');
     performance.measure('wasmFilter-duration', 'wasmFilter-start', 'wasmFilter-end');
     const wasmDuration = performance.getEntriesByName('wasmFilter-duration').pop()?.duration || 0;
-    console.log(`WASM filter took ${wasmDuration.toFixed(1)}ms. Found ${results.length} items.`);
-
-    // --- Sort by SFI (numerical value, ascending) --- 
-    performance.mark('sort-start');
-    // Convert BigInt SFIs from C++ (potentially) to Numbers for reliable JS sort
-    results.forEach(r => { r.sfi = Number(r.sfi); }); 
-    results.sort((a, b) => a.sfi - b.sfi);
-    performance.mark('sort-end');
-    performance.measure('sort-duration', 'sort-start', 'sort-end');
-    const sortDuration = performance.getEntriesByName('sort-duration').pop()?.duration || 0;
-    console.log(`JS SFI Sort took ${sortDuration.toFixed(1)}ms`);
+    console.log(`WASM filter took ${wasmDuration.toFixed(1)}ms. Found ${page.total} items, fetched ${results.length}.`);
+
+    // --- No exact matches: fall back to close matches ---
+    // SKUs carrying all but one of the selected values, ranked by (weighted) matches
+    const valueCount = new Set(selectedPrimes.filter(p => p > 1)).size;
+    if (page.total === 0 && valueCount > 1) {
+        const closeMatches = primeKitInstance.soft_filter_primes(queryPrimes, valueCount - 1, PAGE_SIZE);
+        for (let i = 0; i < closeMatches.size(); ++i) {
+            const item = closeMatches.get(i);
+            results.push({ id: item.id, sfi: Number(item.sfi), ordinal: item.ordinal, matched: `${item.matched}/${valueCount}` });
+        }
+        closeMatches.delete();
+    }
 
     // --- Display Results ---
-    displayResults(results); // Pass sorted results
+    resultsListElement.scrollTop = 0;
+    displayResults(results, page.total);
 
     performance.mark('handleFilter-end');
     performance.measure('handleFilter-duration', 'handleFilter-start', 'handleFilter-end');
     const totalDuration = performance.getEntriesByName('handleFilter-duration').pop()?.duration || 0;
     console.log(`Total handleFilter took ${totalDuration.toFixed(1)}ms`);
 
-    updateStatus(`Displayed ${results.length} matching SKUs (sorted by SFI).`, false, totalDuration);
+    if (page.total === 0 && results.length > 0) {
+        updateStatus(`No exact matches; showing ${results.length} close matches (all but one selected value).`, false, totalDuration);
+    } else {
+        updateStatus(`Found ${page.total} matching SKUs; showing the first ${results.length}.`, false, totalDuration);
+    }
+}
+
+/**
+ * Appends the next page of the current filter once the list is scrolled near its end.
+ */
+function handleResultsScroll() {
+    if (!nextPageCursor || isPageLoading || isSkuSearchActive) return;
+    clearTimeout(scrollDebounceTimeout);
+    scrollDebounceTimeout = setTimeout(() => {
+        const remaining = resultsListElement.scrollHeight - resultsListElement.scrollTop - resultsListElement.clientHeight;
+        if (remaining < SCROLL_FETCH_MARGIN_PX) loadNextPage();
+    }, 50);
+}
+
+/**
+ * Fetches the page after the ones shown and appends it to the results.
+ */
+function loadNextPage() {
+    if (!primeKitInstance || !nextPageCursor || isPageLoading) return;
+    isPageLoading = true;
+    try {
+        const page = primeKitInstance.query_page_primes(currentQueryPrimes, nextPageCursor, PAGE_SIZE, resultBuffer);
+        const rows = readResultBuffer();
+        nextPageCursor = page.next_cursor;
+        displayResults(currentMatchingResults.concat(rows), page.total);
+        updateStatus(`Found ${page.total} matching SKUs; showing ${currentMatchingResults.length}.`);
+    } catch (e) {
+        // The cursor goes stale when the catalog is reloaded or compacted; start over
+        console.warn("Page fetch failed, re-running filter:", e);
+        nextPageCursor = '';
+        handleFilter();
+    } finally {
+        isPageLoading = false;
+    }
 }
 
 /**
@@ -402,8 +475,15 @@ function handleSkuSearch() {
             id: foundItem.id,
             sfi: 'N/A' // SFI not readily available from inventory data alone
         }];
+        // Followed by the SKUs sharing the most attribute values with it
+        const similar = primeKitInstance.similar(targetId, SIMILAR_COUNT);
+        for (let i = 0; i < similar.size(); ++i) {
+            const item = similar.get(i);
+            resultForDisplay.push({ id: item.id, sfi: Number(item.sfi), ordinal: item.ordinal, shared: item.shared });
+        }
+        similar.delete();
         displayResults(resultForDisplay);
-        updateStatus(`Displaying search result for ${targetId}.`);
+        updateStatus(`Displaying search result for ${targetId} and ${resultForDisplay.length - 1} similar SKUs.`);
     } else {
         displayResults([]); // Clear results list
         updateStatus(`SKU ${targetId} not found in the current segment.`, true);
@@ -427,17 +507,18 @@ function clearSkuSearch() {
 function renderSimpleResults(resultsToRender) {
     if (!resultsListElement || !currentSegmentId) return;
     resultsListElement.textContent = resultsToRender
-        .map(result => `[${currentSegmentId}, ${result.id}, ${result.sfi}]`) // Use .sfi
+        .map(result => `[${currentSegmentId}, ${result.id}, ${result.sfi}]` +
+            (result.shared !== undefined ? ` (${result.shared} shared values)` : '') +
+            (result.matched !== undefined ? ` (matches ${result.matched} values)` : '')) // Use .sfi
         .join('\n'); 
 }
 
 /**
  * Updates display with simple results.
  */
-function displayResults(resultsToDisplay) { 
+function displayResults(resultsToDisplay, matchingCount = resultsToDisplay.length) { 
     if (!resultsListElement) return;
     currentMatchingResults = resultsToDisplay; // Store results
-    const matchingCount = currentMatchingResults.length;
     
     resultsCountDiv.textContent = `Total items in segment: ${currentSegmentTotalCount} | Matching: ${matchingCount}`;
     
@@ -492,6 +573,8 @@ async function main() {
     // --- Add Core Event Listeners ---
     setupFilterListeners(); // Attaches Apply button listener
 
+    resultsListElement?.addEventListener('scroll', handleResultsScroll);
+
     if (skuSearchButton) {
         skuSearchButton.addEventListener('click', handleSkuSearch);
     }